@@ -1185,7 +1185,7 @@ void ImplicitHFFFConvolution::convolve(Complex *f, Complex *u)
     );
 }
 
-void fft0bipad::backwards(Complex *f, Complex *u)
+void fft0bipad::expand(Complex *f, Complex *u)
 {
   for(unsigned int i=0; i < M; ++i)
     f[i]=0.0;
@@ -1210,16 +1210,10 @@ void fft0bipad::backwards(Complex *f, Complex *u)
       }
     }
     );
-
-  Backwards->fft(f);
-  Backwards->fft(u);
 }
 
-void fft0bipad::forwards(Complex *f, Complex *u)
+void fft0bipad::reduce(Complex *f, Complex *u)
 {
-  Forwards->fft(f);
-  Forwards->fft(u);
-
   double ninv=0.25/m;
   unsigned int twom=2*m;
   Vec Ninv=LOAD(ninv);
@@ -1088,9 +1088,11 @@ public:
       xfftpad->backwards(F[a]+offset,U3[a]);
   }
 
+  // Convolve M planes, which the multiplier sees as planes start+i.
   void subconvolution(Complex **F, multiplier *pmult,
                       unsigned int r, unsigned int M, unsigned int stride,
-                      unsigned int offset=0) {
+                      unsigned int offset=0, unsigned int start=0) {
+    r += 2*start;
     if(threads > 1) {
 #ifndef FFTWPP_SINGLE_THREAD
 #pragma omp parallel for num_threads(threads)
@@ -1602,11 +1604,12 @@ class fft0bipad {
   unsigned int M;
   unsigned int stride;
   unsigned int s;
-  mfft1d *Backwards;
-  mfft1d *Forwards;
   Complex *ZetaH, *ZetaL;
   unsigned int threads;
 public:
+  mfft1d *Backwards;
+  mfft1d *Forwards;
+
   fft0bipad(unsigned int m, unsigned int M, unsigned int stride,
             Complex *f, unsigned int Threads=fftw::maxthreads) :
     m(m), M(M), stride(stride), threads(Threads) {
@@ -1627,8 +1630,20 @@ public:
     delete Backwards;
   }
 
-  void backwards(Complex *f, Complex *u);
-  void forwards(Complex *f, Complex *u);
+  void expand(Complex *f, Complex *u);
+  void reduce(Complex *f, Complex *u);
+
+  void backwards(Complex *f, Complex *u) {
+    expand(f,u);
+    Backwards->fft(f);
+    Backwards->fft(u);
+  }
+
+  void forwards(Complex *f, Complex *u) {
+    Forwards->fft(f);
+    Forwards->fft(u);
+    reduce(f,u);
+  }
 };
 
 // In-place implicitly dealiased 2D Hermitian ternary convolution.
@@ -1670,16 +1685,16 @@ public:
   }
 
   void initpointers(Complex **&U2, Complex **&V2, Complex **&W2,
-                    Complex *u2, Complex *v2, Complex *w2) {
+                    Complex *u2, Complex *v2, Complex *w2,
+                    unsigned int stride) {
     U2=new Complex *[M];
     V2=new Complex *[M];
     W2=new Complex *[M];
-    unsigned int mu=2*mx*(my+1);
     for(unsigned int s=0; s < M; ++s) {
-      unsigned int smu=s*mu;
-      U2[s]=u2+smu;
-      V2[s]=v2+smu;
-      W2[s]=w2+smu;
+      unsigned int sstride=s*stride;
+      U2[s]=u2+sstride;
+      V2[s]=v2+sstride;
+      W2[s]=w2+sstride;
     }
   }
 
@@ -1689,14 +1704,23 @@ public:
     delete [] U2;
   }
 
-  void init() {
-    xfftpad=new fft0bipad(mx,my,my+1,u2,threads);
+  // Column my is scratch space; when the columns are distributed, every
+  // local column is transformed.
+  void init(const convolveOptions& options) {
+    xfftpad=new fft0bipad(mx,std::min(my,options.ny),options.ny,u2,threads);
 
     yconvolve=new ImplicitHTConvolution(my,u1,v1,w1,M);
     yconvolve->Threads(1);
 
     initpointers(u,v,W,threads);
-    initpointers(U2,V2,W2,u2,v2,w2);
+    initpointers(U2,V2,W2,u2,v2,w2,options.stride2);
+  }
+
+  void set(convolveOptions& options) {
+    if(options.ny == 0) {
+      options.ny=my+1;
+      options.stride2=2*mx*options.ny;
+    }
   }
 
   // u1, v1, and w1 are temporary arrays of size (my+1)*M*threads;
@@ -1707,27 +1731,30 @@ public:
                          Complex *u1, Complex *v1, Complex *w1,
                          Complex *u2, Complex *v2, Complex *w2,
                          unsigned int M=1,
-                         unsigned int threads=fftw::maxthreads) :
+                         unsigned int threads=fftw::maxthreads,
+                         convolveOptions options=defaultconvolveOptions) :
     ThreadBase(threads), mx(mx), my(my), u1(u1), v1(v1), w1(w1),
     u2(u2), v2(v2), w2(w2), M(M), allocated(false) {
-    init();
+    set(options);
+    init(options);
   }
 
   ImplicitHTConvolution2(unsigned int mx, unsigned int my,
                          unsigned int M=1,
-                         unsigned int threads=fftw::maxthreads) :
-    ThreadBase(threads), mx(mx), my(my),
-    u1(utils::ComplexAlign((my+1)*M*threads)),
-    v1(utils::ComplexAlign((my+1)*M*threads)),
-    w1(utils::ComplexAlign((my+1)*M*threads)),
-    u2(utils::ComplexAlign(2*mx*(my+1)*M)),
-    v2(utils::ComplexAlign(2*mx*(my+1)*M)),
-    w2(utils::ComplexAlign(2*mx*(my+1)*M)),
-    M(M), allocated(true) {
-    init();
+                         unsigned int threads=fftw::maxthreads,
+                         convolveOptions options=defaultconvolveOptions) :
+    ThreadBase(threads), mx(mx), my(my), M(M), allocated(true) {
+    set(options);
+    u1=utils::ComplexAlign((my+1)*M*threads);
+    v1=utils::ComplexAlign((my+1)*M*threads);
+    w1=utils::ComplexAlign((my+1)*M*threads);
+    u2=utils::ComplexAlign(options.stride2*M);
+    v2=utils::ComplexAlign(options.stride2*M);
+    w2=utils::ComplexAlign(options.stride2*M);
+    init(options);
   }
 
-  ~ImplicitHTConvolution2() {
+  virtual ~ImplicitHTConvolution2() {
     deletepointers(U2,V2,W2);
     deletepointers(u,v,W,threads);
 
@@ -1744,14 +1771,24 @@ public:
     }
   }
 
+  // Convolve the rows of length my+1 that start within [offset,offset+stop).
+  void subconvolution(Complex **F, Complex **G, Complex **H,
+                      Complex **u, Complex **v, Complex ***W,
+                      unsigned int stop, unsigned int offset=0) {
+    unsigned int my1=my+1;
+#ifndef FFTWPP_SINGLE_THREAD
+#pragma omp parallel for num_threads(threads)
+#endif
+    for(unsigned int i=0; i < stop; i += my1) {
+      unsigned int thread=get_thread_num();
+      yconvolve->convolve(F,G,H,u[thread],v[thread],W[thread],i+offset);
+    }
+  }
+
   void convolve(Complex **F, Complex **G, Complex **H,
                 Complex **u, Complex **v, Complex ***W,
                 Complex **U2, Complex **V2, Complex **W2,
                 bool symmetrize=true, unsigned int offset=0) {
-    Complex *u2=U2[0];
-    Complex *v2=V2[0];
-    Complex *w2=W2[0];
-
     unsigned int my1=my+1;
     unsigned int mu=2*mx*my1;
 
@@ -1759,47 +1796,34 @@ public:
       Complex *f=F[s]+offset;
       if(symmetrize)
         HermitianSymmetrizeX(mx,my1,mx,f);
-      xfftpad->backwards(f,u2+s*mu);
+      xfftpad->backwards(f,U2[s]);
     }
 
     for(unsigned int s=0; s < M; ++s) {
       Complex *g=G[s]+offset;
       if(symmetrize)
         HermitianSymmetrizeX(mx,my1,mx,g);
-      xfftpad->backwards(g,v2+s*mu);
+      xfftpad->backwards(g,V2[s]);
     }
 
     for(unsigned int s=0; s < M; ++s) {
       Complex *h=H[s]+offset;
       if(symmetrize)
         HermitianSymmetrizeX(mx,my1,mx,h);
-      xfftpad->backwards(h,w2+s*mu);
-    }
-
-#ifndef FFTWPP_SINGLE_THREAD
-#pragma omp parallel for num_threads(threads)
-#endif
-    for(unsigned int i=0; i < mu; i += my1) {
-      unsigned int thread=get_thread_num();
-      yconvolve->convolve(F,G,H,u[thread],v[thread],W[thread],i+offset);
+      xfftpad->backwards(h,W2[s]);
     }
 
-#ifndef FFTWPP_SINGLE_THREAD
-#pragma omp parallel for num_threads(threads)
-#endif
-    for(unsigned int i=0; i < mu; i += my1) {
-      unsigned int thread=get_thread_num();
-      yconvolve->convolve(U2,V2,W2,u[thread],v[thread],W[thread],i+offset);
-    }
+    subconvolution(F,G,H,u,v,W,mu,offset);
+    subconvolution(U2,V2,W2,u,v,W,mu);
 
-    xfftpad->forwards(F[0]+offset,u2);
+    xfftpad->forwards(F[0]+offset,U2[0]);
   }
 
   // F, G, and H are distinct pointers to M distinct data blocks each of size
   // 2mx*(my+1), shifted by offset (contents not preserved).
   // The output is returned in F[0].
-  void convolve(Complex **F, Complex **G, Complex **H, bool symmetrize=true,
-                unsigned int offset=0) {
+  virtual void convolve(Complex **F, Complex **G, Complex **H,
+                        bool symmetrize=true, unsigned int offset=0) {
     convolve(F,G,H,u,v,W,U2,V2,W2,symmetrize,offset);
   }
 
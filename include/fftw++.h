@@ -174,6 +174,8 @@ public:
   static fftw_plan (*planner)(fftw *f, Complex *in, Complex *out);
 
   virtual unsigned int Threads() {return threads;}
+  unsigned int Doubles() {return doubles;}
+  int Sign() {return sign;}
 
   static const char *oddshift;
 
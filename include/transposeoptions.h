@@ -6,13 +6,17 @@ extern unsigned int defaultmpithreads;
 
 struct mpiOptions {
   int a; // Block divisor: -1=sqrt(size), 0=Tune
-  int alltoall; // -1=Tune, 0=Optimized, 1=MPI, 2=Inplace
+  int alltoall; // -1=Tune, 0=Optimized, 1=MPI, 2=Inplace, 3=Shared,
+                // 4=Datatype
   unsigned int threads;
   unsigned int verbose;
+  bool single; // Communicate double-precision data in single precision
+  bool batch; // Transpose multiple convolution inputs in one exchange
   mpiOptions(int a=0, int alltoall=-1,
              unsigned int threads=defaultmpithreads,
-             unsigned int verbose=0) :
-    a(a), alltoall(alltoall), threads(threads), verbose(verbose) {}
+             unsigned int verbose=0, bool single=false, bool batch=false) :
+    a(a), alltoall(alltoall), threads(threads), verbose(verbose),
+    single(single), batch(batch) {}
 };
 
 }
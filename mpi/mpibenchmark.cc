@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "mpibenchmark.h"
+
+namespace utils {
+
+commbenchmark::commbenchmark(MPI_Comm communicator, size_t maxbytes,
+                             size_t minbytes, unsigned int iterations) :
+  alpha(0.0), beta(0.0)
+{
+  MPI_Comm_size(communicator,&size);
+  if(size == 1) return;
+
+  if(minbytes == 0) minbytes=1;
+  for(size_t count=minbytes; count < maxbytes; count *= 4)
+    bytes.push_back(count);
+  bytes.push_back(maxbytes);
+
+  std::vector<char> send(size*maxbytes,0), recv(size*maxbytes);
+
+  times.resize(bytes.size());
+  for(unsigned int i=0; i < bytes.size(); ++i)
+    times[i]=exchange(communicator,&send[0],&recv[0],bytes[i],iterations);
+
+  int rank;
+  MPI_Comm_rank(communicator,&rank);
+  if(rank == 0) fit();
+
+  double parm[]={alpha,beta};
+  MPI_Bcast(parm,2,MPI_DOUBLE,0,communicator);
+  alpha=parm[0];
+  beta=parm[1];
+  MPI_Bcast(&times[0],times.size(),MPI_DOUBLE,0,communicator);
+}
+
+// Return the mean time for an alltoall exchange of count bytes per peer.
+double commbenchmark::exchange(MPI_Comm communicator, char *send, char *recv,
+                               size_t count, unsigned int iterations)
+{
+  MPI_Alltoall(send,count,MPI_BYTE,recv,count,MPI_BYTE,communicator);
+  double sum=0.0;
+  for(unsigned int i=0; i < iterations; ++i) {
+    MPI_Barrier(communicator);
+    double t0=MPI_Wtime();
+    MPI_Alltoall(send,count,MPI_BYTE,recv,count,MPI_BYTE,communicator);
+    MPI_Barrier(communicator);
+    sum += MPI_Wtime()-t0;
+  }
+  return iterations > 0 ? sum/iterations : 0.0;
+}
+
+// Least-squares fit of the per-peer times, weighted by relative error so
+// that the small messages determine the latency.
+void commbenchmark::fit()
+{
+  double S=0.0, Sx=0.0, Sy=0.0, Sxx=0.0, Sxy=0.0;
+  for(unsigned int i=0; i < bytes.size(); ++i) {
+    double x=bytes[i];
+    double y=times[i]/(size-1);
+    if(y <= 0.0) continue;
+    double w=1.0/(y*y);
+    S += w;
+    Sx += w*x;
+    Sy += w*y;
+    Sxx += w*x*x;
+    Sxy += w*x*y;
+  }
+  double det=S*Sxx-Sx*Sx;
+  if(det <= 0.0) {
+    alpha=S > 0.0 ? Sy/S : 0.0;
+    beta=0.0;
+    return;
+  }
+  beta=std::max((S*Sxy-Sx*Sy)/det,0.0);
+  alpha=std::max((Sy-beta*Sx)/S,0.0);
+}
+
+double commbenchmark::transpose(unsigned int N, unsigned int M,
+                                size_t element, int P, int a) const
+{
+  if(P <= 1) return 0.0;
+  double block=(double) N*M*element/((double) P*P);
+  if(a <= 1) return alltoall(P,block);
+  int b=P/a;
+  return alltoall(b,block*b)+alltoall(a,block*a);
+}
+
+}
@@ -0,0 +1,63 @@
+#ifndef __mpibenchmark_h__
+#define __mpibenchmark_h__ 1
+
+/*
+  Communication microbenchmark.
+
+  Times MPI_Alltoall over a communicator for a sweep of per-peer message
+  sizes and fits the linear (alpha-beta) model
+
+  t(bytes)=(P-1)*(alpha+beta*bytes)
+
+  for an exchange among P processes, where alpha is the per-message latency
+  in seconds and beta is the inverse bandwidth in seconds per byte. The
+  fitted model is shared by all processes of the communicator.
+*/
+
+#include <mpi.h>
+#include <vector>
+#include <cstddef>
+
+namespace utils {
+
+class commbenchmark {
+  std::vector<size_t> bytes;  // Per-peer message sizes
+  std::vector<double> times;  // Mean time of each exchange
+  double alpha,beta;
+  int size;
+
+  double exchange(MPI_Comm communicator, char *send, char *recv,
+                  size_t count, unsigned int iterations);
+  void fit();
+public:
+  // Time iterations exchanges of each message size from minbytes up to
+  // maxbytes, increasing by factors of 4.
+  commbenchmark(MPI_Comm communicator, size_t maxbytes=160000,
+                size_t minbytes=32, unsigned int iterations=200);
+
+  double Alpha() const {return alpha;}
+  double Beta() const {return beta;}
+  int Size() const {return size;}
+
+  unsigned int samples() const {return bytes.size();}
+  size_t Bytes(unsigned int i) const {return bytes[i];}
+  double Time(unsigned int i) const {return times[i];}
+
+  // Message size in bytes at which latency and bandwidth costs are equal.
+  double crossover() const {return beta > 0.0 ? alpha/beta : 0.0;}
+
+  // Predicted time to exchange count bytes with each of P-1 peers.
+  double alltoall(int P, double count) const {
+    return P > 1 ? (P-1)*(alpha+beta*count) : 0.0;
+  }
+
+  // Predicted time for an N x M transpose of elements of the given size,
+  // distributed uniformly over P processes, using a block divisor a
+  // (cf. mpitranspose).
+  double transpose(unsigned int N, unsigned int M, size_t element, int P,
+                   int a=1) const;
+};
+
+}
+
+#endif
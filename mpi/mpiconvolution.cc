@@ -4,39 +4,178 @@ using namespace utils;
 
 namespace fftwpp {
 
+unsigned int pipelinechunks=0;
+
+// Apply the FFT stage fft to f, recording it when tracing.
+template<class FFT>
+inline void fftStage(FFT *fft, Complex *f)
+{
+  traceScope trace("fft","fft");
+  fft->fft(f);
+}
+
+static void multnone(Complex **, unsigned int, const unsigned int,
+                     const unsigned int *, unsigned int, unsigned int)
+{
+}
+
+// Multiply the local block by zeta^k to shift to the odd residue.
+void ImplicitConvolutionMPI::pretransform(Complex *f)
+{
+  unsigned int k0=d.x0*d.Y;
+  unsigned int n=d.x*d.Y;
+#ifndef FFTWPP_SINGLE_THREAD
+#pragma omp parallel for num_threads(threads)
+#endif
+  for(unsigned int k=0; k < n; ++k) {
+    unsigned int K=k0+k;
+    f[k] *= ZetaH[K/s]*ZetaL[K % s];
+  }
+}
+
+// Combine the odd residue f with the even residue u.
+void ImplicitConvolutionMPI::posttransform(Complex *f, Complex *u)
+{
+  double ninv=0.5/m;
+  unsigned int k0=d.x0*d.Y;
+  unsigned int n=d.x*d.Y;
+#ifndef FFTWPP_SINGLE_THREAD
+#pragma omp parallel for num_threads(threads)
+#endif
+  for(unsigned int k=0; k < n; ++k) {
+    unsigned int K=k0+k;
+    f[k]=ninv*(conj(ZetaH[K/s]*ZetaL[K % s])*f[k]+u[k]);
+  }
+}
+
+void ImplicitConvolutionMPI::convolve(Complex **F, multiplier *pmult,
+                                      unsigned int i, unsigned int offset)
+{
+  traceCall trace("convolve");
+  unsigned int C=std::max(A,B);
+  unsigned int n=d.x*d.Y;
+  std::vector<Complex *> P(C);
+  for(unsigned int a=0; a < C; ++a)
+    P[a]=F[a]+offset;
+
+  // Start the transposes of both residues of all inputs before waiting.
+  for(unsigned int a=0; a < A; ++a) {
+    utils::copy(P[a],U[a],n,threads);
+    FFT[a]->iForward(U[a],U[a]);
+    pretransform(P[a]);
+    FFT[C+a]->iForward(P[a],P[a]);
+  }
+  for(unsigned int a=0; a < A; ++a) {
+    FFT[a]->ForwardWait0(U[a]);
+    FFT[C+a]->ForwardWait0(P[a]);
+  }
+  for(unsigned int a=0; a < A; ++a) {
+    FFT[a]->ForwardWait1(U[a]);
+    FFT[C+a]->ForwardWait1(P[a]);
+  }
+
+  (*pmult)(U,n,0,NULL,0,threads); // multiply even indices
+  (*pmult)(&P[0],n,0,NULL,1,threads); // multiply odd indices
+
+  for(unsigned int b=0; b < B; ++b) {
+    FFT[b]->iBackward(U[b],U[b]);
+    FFT[C+b]->iBackward(P[b],P[b]);
+  }
+  for(unsigned int b=0; b < B; ++b) {
+    FFT[b]->BackwardWait0(U[b]);
+    FFT[C+b]->BackwardWait0(P[b]);
+  }
+  for(unsigned int b=0; b < B; ++b) {
+    FFT[b]->BackwardWait1(U[b]);
+    FFT[C+b]->BackwardWait1(P[b]);
+    posttransform(P[b],U[b]);
+  }
+}
+
+// Transpose the A inputs, and then the B outputs, of each residue together.
+void ImplicitConvolution2MPI::convolveBatch(Complex **F, multiplier *pmult,
+                                            unsigned int offset)
+{
+  std::vector<Complex *> f(std::max(A,B));
+  for(unsigned int a=0; a < f.size(); ++a)
+    f[a]=F[a]+offset;
+  for(unsigned int a=0; a < A; ++a) {
+    xfftpad->expand(f[a],U2[a]);
+    fftStage(xfftpad->Backwards,f[a]);
+  }
+  TA->ilocalize1(&f[0],NULL,A);
+  for(unsigned int a=0; a < A; ++a)
+    fftStage(xfftpad->Backwards,U2[a]);
+  UA->ilocalize1(U2,NULL,A);
+  
+  TA->wait();
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(F,pmult,0,d.x,d.Y,offset);
+  }
+  TA->ilocalize0(&f[0],NULL,B);
+  UA->wait();
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(U2,pmult,1,d.x,d.Y);
+  }
+  UA->ilocalize0(U2,NULL,B);
+  
+  TA->wait();
+  for(unsigned int b=0; b < B; ++b)
+    fftStage(xfftpad->Forwards,f[b]);
+  UA->wait();
+  for(unsigned int b=0; b < B; ++b) {
+    fftStage(xfftpad->Forwards,U2[b]);
+    xfftpad->reduce(f[b],U2[b]);
+  }
+}
+
 void ImplicitConvolution2MPI::convolve(Complex **F, multiplier *pmult,
                                        unsigned int i, unsigned int offset)
 {
+  traceCall trace("convolve");
+  if(TA) {
+    convolveBatch(F,pmult,offset);
+    return;
+  }
+  
   for(unsigned int a=0; a < A; ++a) {
     Complex *f=F[a]+offset;
     Complex *u=U2[a];
     xfftpad->expand(f,u);
-    xfftpad->Backwards->fft(f);
+    fftStage(xfftpad->Backwards,f);
     if(a > 0) T->wait();
     T->ilocalize1(f);
-    xfftpad->Backwards->fft(u);
+    fftStage(xfftpad->Backwards,u);
     if(a > 0) U->wait();
     U->ilocalize1(u);
   }
       
   T->wait();
-  subconvolution(F,pmult,0,d.x,d.Y,offset);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(F,pmult,0,d.x,d.Y,offset);
+  }
   U->wait0();
   for(unsigned int b=0; b < B; ++b) {
     if(b > 0) T->wait();
     T->ilocalize0(F[b]+offset);
   }
   U->wait1();
-  subconvolution(U2,pmult,1,d.x,d.Y);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(U2,pmult,1,d.x,d.Y);
+  }
   T->wait();
     
   for(unsigned int b=0; b < B; ++b) {
     Complex *f=F[b]+offset;
     Complex *u=U2[b];
     U->ilocalize0(u);
-    xfftpad->Forwards->fft(f);
+    fftStage(xfftpad->Forwards,f);
     U->wait();
-    xfftpad->Forwards->fft(u);
+    fftStage(xfftpad->Forwards,u);
     xfftpad->reduce(f,u);
   }
 }
@@ -45,6 +184,7 @@ void ImplicitHConvolution2MPI::convolve(Complex **F, realmultiplier *pmult,
                                         bool symmetrize, unsigned int i,
                                         unsigned int offset)
 {
+  traceCall trace("convolve");
   if(d.y0 > 0) symmetrize=false;
 
   for(unsigned int a=0; a < A; ++a) {
@@ -53,7 +193,7 @@ void ImplicitHConvolution2MPI::convolve(Complex **F, realmultiplier *pmult,
     if(symmetrize)
       HermitianSymmetrizeX(mx,d.y,mx-xcompact,f);
     xfftpad->expand(f,u);
-    xfftpad->Backwards->fft(f);
+    fftStage(xfftpad->Backwards,f);
     if(a > 0) {
       T->wait0();
       U->wait0();
@@ -61,21 +201,27 @@ void ImplicitHConvolution2MPI::convolve(Complex **F, realmultiplier *pmult,
     xfftpad->Backwards1(f,u);
     if(a > 0) T->wait1();
     T->ilocalize1(f);
-    xfftpad->Backwards->fft(u);
+    fftStage(xfftpad->Backwards,u);
     if(a > 0) U->wait1();
     U->ilocalize1(u);
   }
   
       
   T->wait();
-  subconvolution(F,pmult,xfftpad->findex,d.x,d.Y,offset);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(F,pmult,xfftpad->findex,d.x,d.Y,offset);
+  }
   U->wait0();
   for(unsigned int b=0; b < B; ++b) {
     if(b > 0) T->wait();
     T->ilocalize0(F[b]+offset);
   }
   U->wait1();
-  subconvolution(U2,pmult,xfftpad->uindex,du.x,du.Y);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(U2,pmult,xfftpad->uindex,du.x,du.Y);
+  }
   T->wait();
     
   for(unsigned int b=0; b < B; ++b) {
@@ -85,8 +231,247 @@ void ImplicitHConvolution2MPI::convolve(Complex **F, realmultiplier *pmult,
     xfftpad->Forwards0(f);
     U->wait();
     xfftpad->Forwards1(f,u);
-    xfftpad->Forwards->fft(f);
-    xfftpad->Forwards->fft(u);
+    fftStage(xfftpad->Forwards,f);
+    fftStage(xfftpad->Forwards,u);
+    xfftpad->reduce(f,u);
+  }
+}
+
+void ImplicitHTConvolution2MPI::convolve(Complex **F, Complex **G,
+                                         Complex **H, bool symmetrize,
+                                         unsigned int offset)
+{
+  traceCall trace("convolve");
+  if(d.y0 > 0) symmetrize=false;
+
+  Complex **In[]={F,G,H};
+  Complex **Work[]={U2,V2,W2};
+  unsigned int A=3*M;
+  for(unsigned int a=0; a < A; ++a) {
+    Complex *f=In[a/M][a%M]+offset;
+    Complex *w=Work[a/M][a%M];
+    if(symmetrize)
+      HermitianSymmetrizeX(mx,d.y,mx,f);
+    xfftpad->expand(f,w);
+    fftStage(xfftpad->Backwards,f);
+    if(a > 0) T->wait();
+    T->ilocalize1(f);
+    fftStage(xfftpad->Backwards,w);
+    if(a > 0) U->wait();
+    U->ilocalize1(w);
+  }
+
+  unsigned int stop=d.x*d.Y;
+  T->wait();
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(F,G,H,u,v,W,stop,offset);
+  }
+  Complex *f=F[0]+offset;
+  T->ilocalize0(f);
+  U->wait();
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(U2,V2,W2,u,v,W,stop);
+  }
+  T->wait();
+
+  Complex *w=U2[0];
+  U->ilocalize0(w);
+  fftStage(xfftpad->Forwards,f);
+  U->wait();
+  fftStage(xfftpad->Forwards,w);
+  xfftpad->reduce(f,w);
+}
+
+// Transpose the A inputs, and then the B outputs, of each residue together.
+void ImplicitConvolution3MPI::convolveBatch(Complex **F, multiplier *pmult,
+                                            unsigned int offset)
+{
+  std::vector<Complex *> f(std::max(A,B));
+  for(unsigned int a=0; a < f.size(); ++a)
+    f[a]=F[a]+offset;
+  for(unsigned int a=0; a < A; ++a) {
+    xfftpad->expand(f[a],U3[a]);
+    fftStage(xfftpad->Backwards,f[a]);
+  }
+  TA->ilocalize1(&f[0],NULL,A);
+  for(unsigned int a=0; a < A; ++a)
+    fftStage(xfftpad->Backwards,U3[a]);
+  UA->ilocalize1(U3,NULL,A);
+      
+  unsigned int stride=d.Y*d.z;
+    
+  TA->wait();
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(F,pmult,0,d.x,stride,offset);
+  }
+  TA->ilocalize0(&f[0],NULL,B);
+  UA->wait();
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(U3,pmult,1,d.x,stride);
+  }
+  UA->ilocalize0(U3,NULL,B);
+  
+  TA->wait();
+  for(unsigned int b=0; b < B; ++b)
+    fftStage(xfftpad->Forwards,f[b]);
+  UA->wait();
+  for(unsigned int b=0; b < B; ++b) {
+    fftStage(xfftpad->Forwards,U3[b]);
+    xfftpad->reduce(f[b],U3[b]);
+  }
+}
+
+// Chunk c consists of the local x planes [c*x/C,(c+1)*x/C) of every
+// process, so each process must hold a multiple of C planes.
+bool ImplicitConvolution3MPI::pipelinable(unsigned int C)
+{
+  int ok=C > 1 && d.x % C == 0;
+  int all;
+  MPI_Allreduce(&ok,&all,1,MPI_INT,MPI_MIN,d.xy.communicator);
+  return all;
+}
+
+void ImplicitConvolution3MPI::initchunks(unsigned int C)
+{
+  chunks=C;
+  if(C == 1) return;
+  unsigned int A2=2*A;
+  unsigned int size=d.x/C*d.Y*d.z;
+  g=ComplexAlign(2*A2*size);
+  G.resize(2*A2);
+  for(unsigned int j=0; j < 2*A2; ++j)
+    G[j]=g+j*size;
+  for(unsigned int p=0; p < 2; ++p)
+    Tc[p]=new utils::chunktranspose<Complex>(d.x,d.Y,d.xy.y,d.z,C,
+                                             d.xy.communicator);
+}
+
+void ImplicitConvolution3MPI::deletechunks()
+{
+  if(chunks > 1) {
+    delete Tc[1];
+    delete Tc[0];
+    deleteAlign(g);
+    G.clear();
+  }
+  chunks=1;
+}
+
+// Time the pipelined convolution for each admissible power-of-two chunk
+// count, unless pipelinechunks specifies one.
+void ImplicitConvolution3MPI::tunechunks(MPI_Comm global)
+{
+  if(pipelinechunks > 0) {
+    initchunks(pipelinable(pipelinechunks) ? pipelinechunks : 1);
+    return;
+  }
+  
+  unsigned int Cmax=1;
+  while(pipelinable(2*Cmax)) Cmax *= 2;
+  int Cmax0=Cmax;
+  MPI_Allreduce(&Cmax0,&Cmax,1,MPI_INT,MPI_MIN,global);
+  if(Cmax == 1) return;
+  
+  int rank;
+  MPI_Comm_rank(global,&rank);
+  
+  Complex **F=new Complex*[A];
+  for(unsigned int a=0; a < A; ++a) {
+    F[a]=ComplexAlign(d.n);
+    for(unsigned int i=0; i < d.n; ++i)
+      F[a][i]=0.0;
+  }
+  
+  double T0=DBL_MAX;
+  int best=1;
+  for(unsigned int C=1; C <= Cmax; C *= 2) {
+    initchunks(C);
+    convolve(F,multnone);
+    MPI_Barrier(global);
+    double t0=utils::totalseconds();
+    convolve(F,multnone);
+    MPI_Barrier(global);
+    double t=utils::totalseconds()-t0;
+    deletechunks();
+    if(rank == 0 && t < T0) {
+      T0=t;
+      best=C;
+    }
+  }
+  MPI_Bcast(&best,1,MPI_INT,0,global);
+  
+  for(unsigned int a=0; a < A; ++a)
+    deleteAlign(F[a]);
+  delete [] F;
+  
+  initchunks(best);
+}
+
+void ImplicitConvolution3MPI::convolvePipeline(Complex **F, multiplier *pmult,
+                                               unsigned int offset)
+{
+  for(unsigned int a=0; a < A; ++a) {
+    Complex *f=F[a]+offset;
+    Complex *u=U3[a];
+    xfftpad->expand(f,u);
+    fftStage(xfftpad->Backwards,f);
+    fftStage(xfftpad->Backwards,u);
+  }
+  
+  unsigned int stride=d.Y*d.z;
+  unsigned int nc=d.x/chunks;
+  unsigned int A2=2*A,B2=2*B;
+  
+  // Inputs F[0..A-1],U3[0..A-1]; outputs F[0..B-1],U3[0..B-1].
+  std::vector<Complex *> f(A2),h(B2),g0(B2),g1(B2);
+  for(unsigned int a=0; a < A; ++a) {
+    f[a]=F[a]+offset;
+    f[A+a]=U3[a];
+  }
+  for(unsigned int b=0; b < B; ++b) {
+    h[b]=f[b];
+    h[B+b]=f[A+b];
+    g0[b]=G[b];
+    g0[B+b]=G[A+b];
+    g1[b]=G[A2+b];
+    g1[B+b]=G[A2+A+b];
+  }
+  Complex **gout[]={&g0[0],&g1[0]};
+  
+  Tc[0]->ilocalize1(&f[0],&G[0],A2,0);
+  
+  for(unsigned int c=0; c < chunks; ++c) {
+    unsigned int p=c % 2;
+    if(c+1 < chunks) {
+      unsigned int q=1-p;
+      Tc[q]->wait();
+      Tc[q]->ilocalize1(&f[0],&G[A2*q],A2,c+1);
+    }
+    Tc[p]->wait();
+    
+    {
+      traceScope trace("subconvolution","convolve");
+      subconvolution(&G[A2*p],pmult,0,nc,stride,0,c*nc);
+    }
+    {
+      traceScope trace("subconvolution","convolve");
+      subconvolution(&G[A2*p+A],pmult,1,nc,stride,0,c*nc);
+    }
+    
+    Tc[p]->ilocalize0(gout[p],&h[0],B2,c);
+  }
+  Tc[0]->wait();
+  Tc[1]->wait();
+
+  for(unsigned int b=0; b < B; ++b) {
+    Complex *f=F[b]+offset;
+    Complex *u=U3[b];
+    fftStage(xfftpad->Forwards,f);
+    fftStage(xfftpad->Forwards,u);
     xfftpad->reduce(f,u);
   }
 }
@@ -94,16 +479,27 @@ void ImplicitHConvolution2MPI::convolve(Complex **F, realmultiplier *pmult,
 void ImplicitConvolution3MPI::convolve(Complex **F, multiplier *pmult,
                                        unsigned int i, unsigned int offset) 
 {
+  traceCall trace("convolve");
+  if(chunks > 1) {
+    convolvePipeline(F,pmult,offset);
+    return;
+  }
+  
+  if(TA) {
+    convolveBatch(F,pmult,offset);
+    return;
+  }
+  
   for(unsigned int a=0; a < A; ++a) {
     Complex *f=F[a]+offset;
     Complex *u=U3[a];
     xfftpad->expand(f,u);
-    xfftpad->Backwards->fft(f);
+    fftStage(xfftpad->Backwards,f);
     if(T) {
       if(a > 0) T->wait();
       T->ilocalize1(f);
     }
-    xfftpad->Backwards->fft(u);
+    fftStage(xfftpad->Backwards,u);
     if(U) {
       if(a > 0) U->wait();
       U->ilocalize1(u);
@@ -113,7 +509,10 @@ void ImplicitConvolution3MPI::convolve(Complex **F, multiplier *pmult,
   unsigned int stride=d.Y*d.z;
     
   if(T) T->wait();
-  subconvolution(F,pmult,0,d.x,stride,offset);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(F,pmult,0,d.x,stride,offset);
+  }
   if(U) {
     U->wait0();
     for(unsigned int b=0; b < B; ++b) {
@@ -122,7 +521,10 @@ void ImplicitConvolution3MPI::convolve(Complex **F, multiplier *pmult,
     }
     U->wait1();
   }
-  subconvolution(U3,pmult,1,d.x,stride);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(U3,pmult,1,d.x,stride);
+  }
   if(T) T->wait();
     
   for(unsigned int b=0; b < B; ++b) {
@@ -130,16 +532,20 @@ void ImplicitConvolution3MPI::convolve(Complex **F, multiplier *pmult,
     Complex *u=U3[b];
     if(U)
       U->ilocalize0(u);
-    xfftpad->Forwards->fft(f);
+    fftStage(xfftpad->Forwards,f);
     if(U)
       U->wait();
-    xfftpad->Forwards->fft(u);
+    fftStage(xfftpad->Forwards,u);
     xfftpad->reduce(f,u);
   }
 }
 
 // Enforce 3D Hermiticity using given (x,y > 0,z=0) and (x >= 0,y=0,z=0) data.
-// u0 is an optional work array of size nu=d.X-!xcompact.
+// Each process of the XY plane sends the reflected y>=0 columns it owns to
+// the owners of the corresponding y<0 columns with a single MPI_Alltoallv,
+// using an exchange plan computed on the first call. The columns sent and
+// received, each of d.X-!xcompact values, are staged in the optional work
+// array u0 of size nu if they fit; otherwise in a buffer cached in d.
 void HermitianSymmetrizeXYMPI(unsigned int mx, unsigned int my,
                               split3& d, bool xcompact, bool ycompact,
                               Complex *f, unsigned int nu, Complex *u0)
@@ -159,6 +565,7 @@ void HermitianSymmetrizeXYMPI(unsigned int mx, unsigned int my,
   unsigned int dy=d.xy.y;
   unsigned int j0=y0 == 0 ? yextra : 0;
   unsigned int start=(yorigin > y0) ? yorigin-y0 : 0;
+  unsigned int stop=std::min(dy,start);
   
   if(d.XYplane == NULL) {
     d.XYplane=new MPI_Comm;
@@ -166,52 +573,77 @@ void HermitianSymmetrizeXYMPI(unsigned int mx, unsigned int my,
     if(d.z0 != 0) return;
     MPI_Comm_rank(*d.XYplane,&rank);
     MPI_Comm_size(*d.XYplane,&size);
+    std::vector<unsigned int> n(size),ystart(size);
+    MPI_Allgather(&dy,1,MPI_UNSIGNED,&n[0],1,MPI_UNSIGNED,*d.XYplane);
+    MPI_Allgather(&y0,1,MPI_UNSIGNED,&ystart[0],1,MPI_UNSIGNED,*d.XYplane);
+    std::vector<int> process(d.Y);
+    for(int p=0; p < size; ++p) {
+      unsigned int stop=ystart[p]+n[p];
+      for(unsigned int j=ystart[p]; j < stop; ++j)
+        process[j]=p;
+    }
+    
     d.reflect=new int[dy];
-    unsigned int n[size];
-    unsigned int start[size];
-    n[rank]=dy;
-    start[rank]=y0;
-    MPI_Allgather(MPI_IN_PLACE,0,MPI_UNSIGNED,n,1,MPI_UNSIGNED,*d.XYplane);
-    MPI_Allgather(MPI_IN_PLACE,0,MPI_UNSIGNED,start,1,MPI_UNSIGNED,*d.XYplane);
-    if(rank == 0) {
-      int process[d.Y];
-      for(int p=0; p < size; ++p) {
-        unsigned int stop=start[p]+n[p];
-        for(unsigned int j=start[p]; j < stop; ++j)
-          process[j]=p;
-      }
+    for(unsigned int j=0; j < dy; ++j)
+      d.reflect[j]=j < j0 ? rank : process[2*yorigin-y0-j];
     
-      for(unsigned int j=j0; j < dy; ++j)
-        d.reflect[j]=process[2*yorigin-y0-j];
-      for(int p=1; p < size; ++p) {
-        for(unsigned int j=start[p] == 0 ? yextra : 0; j < n[p];
-            ++j)
-          MPI_Send(process+2*yorigin-start[p]-j,1,MPI_INT,p,j,
-                   *d.XYplane);
-      }
-    } else {
-      for(unsigned int j=0; j < dy; ++j)
-        MPI_Recv(d.reflect+j,1,MPI_INT,0,j,*d.XYplane,MPI_STATUS_IGNORE);
+    // Counts and displacements, in doubles, sent to and received from
+    // each process.
+    d.exchange=new int[4*size];
+    int *sendcounts=d.exchange;
+    int *senddispls=sendcounts+size;
+    int *recvcounts=senddispls+size;
+    int *recvdispls=recvcounts+size;
+    for(int p=0; p < size; ++p)
+      sendcounts[p]=recvcounts[p]=0;
+    for(unsigned int j=start; j < dy; ++j)
+      if(d.reflect[j] != rank) sendcounts[d.reflect[j]] += 2*nx;
+    for(unsigned int j=j0; j < stop; ++j)
+      if(d.reflect[j] != rank) recvcounts[d.reflect[j]] += 2*nx;
+    senddispls[0]=recvdispls[0]=0;
+    for(int p=1; p < size; ++p) {
+      senddispls[p]=senddispls[p-1]+sendcounts[p-1];
+      recvdispls[p]=recvdispls[p-1]+recvcounts[p-1];
     }
   }
   if(d.z0 != 0) return;
   MPI_Comm_rank(*d.XYplane,&rank);
-
-  Complex *u=(nu < nx) ? ComplexAlign(nx) : u0;
+  MPI_Comm_size(*d.XYplane,&size);
+  
+  int *sendcounts=d.exchange;
+  int *senddispls=sendcounts+size;
+  int *recvcounts=senddispls+size;
+  int *recvdispls=recvcounts+size;
+  unsigned int nsend=(senddispls[size-1]+sendcounts[size-1])/2;
+  unsigned int nrecv=(recvdispls[size-1]+recvcounts[size-1])/2;
+  unsigned int nbuf=nsend+nrecv;
+  Complex *send=u0;
+  if(nu < nbuf) {
+    if(!d.buffer) d.buffer=ComplexAlign(nbuf);
+    send=d.buffer;
+  }
+  Complex *recv=send+nsend;
+  std::vector<int> pos(size);
+  
+  // Columns are packed in decreasing order of y, so that each receiver
+  // unpacks its reflected columns in increasing order of y.
+  for(int p=0; p < size; ++p)
+    pos[p]=senddispls[p]/2;
   unsigned int stride=dy*d.z;
-  for(unsigned int j=start; j < dy; ++j) {
-    for(unsigned int i=0; i < nx; ++i)
-      u[i]=conj(f[stride*(d.X-1-i)+d.z*j]);
+  for(unsigned int j=dy; j-- > start;) {
     int J=d.reflect[j];
-    if(J != rank)
-      MPI_Send(u,2*nx,MPI_DOUBLE,J,0,*d.XYplane);
-    else {
+    if(J != rank) {
+      Complex *u=send+pos[J];
+      pos[J] += nx;
+      for(unsigned int i=0; i < nx; ++i)
+        u[i]=conj(f[stride*(d.X-1-i)+d.z*j]);
+    } else {
       if(y0+j != yorigin) {
         int offset=d.z*(2*(yorigin-y0)-j);
         for(unsigned int i=0; i < nx; ++i) {
           unsigned int N=stride*(i+xextra)+offset;
           if(N < d.n)
-            f[N]=u[i];
+            f[N]=conj(f[stride*(d.X-1-i)+d.z*j]);
           else {
             if(rank == 0)
               std::cerr << "Invalid index in HermitianSymmetrizeXYMPI."
@@ -229,29 +661,34 @@ void HermitianSymmetrizeXYMPI(unsigned int mx, unsigned int my,
     }
   }
 
-  for(unsigned int j=std::min(dy,start); j-- > j0;) {
+  MPI_Alltoallv(send,sendcounts,senddispls,MPI_DOUBLE,
+                recv,recvcounts,recvdispls,MPI_DOUBLE,*d.XYplane);
+
+  for(int p=0; p < size; ++p)
+    pos[p]=recvdispls[p]/2;
+  for(unsigned int j=j0; j < stop; ++j) {
     int J=d.reflect[j];
     if(J != rank) {
-      MPI_Recv(u,2*nx,MPI_DOUBLE,J,0,*d.XYplane,MPI_STATUS_IGNORE);
+      Complex *u=recv+pos[J];
+      pos[J] += nx;
       for(unsigned int i=0; i < nx; ++i)
         f[stride*(i+xextra)+d.z*j]=u[i];
     }
   }
-  
-  if(nu < nx) deleteAlign(u);
 }
 
 void ImplicitHConvolution3MPI::convolve(Complex **F, realmultiplier *pmult,
                                         bool symmetrize, unsigned int i,
                                         unsigned int offset)
 {
+  traceCall trace("convolve");
   for(unsigned int a=0; a < A; ++a) {
     Complex *f=F[a]+offset;
     Complex *u=U3[a];
     if(symmetrize)
       HermitianSymmetrizeXYMPI(mx,my,d,xcompact,ycompact,f,du.n,u);
     xfftpad->expand(f,u);
-    xfftpad->Backwards->fft(f);
+    fftStage(xfftpad->Backwards,f);
     if(T && a > 0) {
       T->wait0();
       U->wait0();
@@ -261,7 +698,7 @@ void ImplicitHConvolution3MPI::convolve(Complex **F, realmultiplier *pmult,
       if(a > 0) T->wait1();
       T->ilocalize1(f);
     }
-    xfftpad->Backwards->fft(u);
+    fftStage(xfftpad->Backwards,u);
     if(U) {
       if(a > 0) U->wait1();
       U->ilocalize1(u);
@@ -269,7 +706,10 @@ void ImplicitHConvolution3MPI::convolve(Complex **F, realmultiplier *pmult,
   }
 
   if(T) T->wait();
-  subconvolution(F,pmult,xfftpad->findex,d.x,d.Y*d.z,offset);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(F,pmult,xfftpad->findex,d.x,d.Y*d.z,offset);
+  }
   if(U) {
     U->wait0();
     for(unsigned int b=0; b < B; ++b) {
@@ -278,7 +718,10 @@ void ImplicitHConvolution3MPI::convolve(Complex **F, realmultiplier *pmult,
     }
     U->wait1();
   }
-  subconvolution(U3,pmult,xfftpad->uindex,du.x,du.Y*du.z);
+  {
+    traceScope trace("subconvolution","convolve");
+    subconvolution(U3,pmult,xfftpad->uindex,du.x,du.Y*du.z);
+  }
   if(T) T->wait();
     
   for(unsigned int b=0; b < B; ++b) {
@@ -290,10 +733,84 @@ void ImplicitHConvolution3MPI::convolve(Complex **F, realmultiplier *pmult,
     if(U) 
       U->wait();
     xfftpad->Forwards1(f,u);
-    xfftpad->Forwards->fft(f);
-    xfftpad->Forwards->fft(u);
+    fftStage(xfftpad->Forwards,f);
+    fftStage(xfftpad->Forwards,u);
     xfftpad->reduce(f,u);
   }
 }
 
+void ImplicitHTConvolution3MPI::initMPI(Complex *f,
+                                        const utils::mpiOptions& mpi,
+                                        Complex *work, Complex *work2,
+                                        MPI_Comm global)
+{
+  global=global ? global : d.communicator;
+  unsigned int nyz=d.xy.y*d.z;
+  d.Activate();
+  xfftpad=new fft0bipad(mx,nyz,nyz,u3,threads);
+  if(d.z < d.Z)
+    yzconvolve=new ImplicitHTConvolution2MPI(my,mz,d.yz,f,mpi,M,threads,
+                                             work2,global);
+  else
+    yzconvolve=new ImplicitHTConvolution2(my,mz,M,threads);
+  initpointers(U3,V3,W3);
+
+  if(d.xy.y < d.Y) {
+    T=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.xy.y,d.z,f,work,
+                                       d.xy.communicator,mpi,global);
+    U=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.xy.y,d.z,u3,work,
+                                       d.xy.communicator,mpi,global);
+  } else {T=U=NULL;}
+  d.Deactivate();
+}
+
+void ImplicitHTConvolution3MPI::convolve(Complex **F, Complex **G,
+                                         Complex **H, bool symmetrize,
+                                         unsigned int offset)
+{
+  traceCall trace("convolve");
+  Complex **In[]={F,G,H};
+  Complex **Work[]={U3,V3,W3};
+  unsigned int A=3*M;
+  for(unsigned int a=0; a < A; ++a) {
+    Complex *f=In[a/M][a%M]+offset;
+    Complex *w=Work[a/M][a%M];
+    if(symmetrize)
+      HermitianSymmetrizeXYMPI(mx,my,d,false,false,f,d.n,w);
+    xfftpad->expand(f,w);
+    fftStage(xfftpad->Backwards,f);
+    if(T) {
+      if(a > 0) T->wait();
+      T->ilocalize1(f);
+    }
+    fftStage(xfftpad->Backwards,w);
+    if(U) {
+      if(a > 0) U->wait();
+      U->ilocalize1(w);
+    }
+  }
+
+  unsigned int stride=d.Y*d.z;
+  if(T) T->wait();
+  for(unsigned int i=0; i < d.x; ++i)
+    yzconvolve->convolve(F,G,H,false,offset+i*stride);
+  Complex *f=F[0]+offset;
+  if(T) {
+    T->ilocalize0(f);
+    U->wait();
+  }
+  for(unsigned int i=0; i < d.x; ++i)
+    yzconvolve->convolve(U3,V3,W3,false,i*stride);
+
+  Complex *w=U3[0];
+  if(T) {
+    T->wait();
+    U->ilocalize0(w);
+  }
+  fftStage(xfftpad->Forwards,f);
+  if(U) U->wait();
+  fftStage(xfftpad->Forwards,w);
+  xfftpad->reduce(f,w);
+}
+
 } // namespace fftwpp
@@ -9,11 +9,102 @@
 
 namespace fftwpp {
 
+// Number of x chunks pipelined by ImplicitConvolution3MPI [0=Tune].
+extern unsigned int pipelinechunks;
+
+// In-place implicitly dealiased 1D complex convolution of length m=d.X*d.Y,
+// distributed in contiguous blocks of d.x*d.Y values starting at d.x0*d.Y.
+// The even and odd residues of the 2m-padded transform are computed with
+// fft1dMPI; the multiplier sees both in the transposed order of fft1dMPI.
+class ImplicitConvolutionMPI : public ThreadBase {
+protected:
+  utils::split d;
+  unsigned int m;
+  Complex **U;
+  unsigned int A;
+  unsigned int B;
+  Complex *u;
+  unsigned int s;
+  Complex *ZetaH, *ZetaL;
+  fft1dMPI **FFT; // FFT[a] acts on U[a]; FFT[C+a] acts on F[a].
+  bool allocated;
+
+  void init(Complex *F0, const utils::mpiOptions& mpi) {
+    unsigned int C=std::max(A,B);
+    U=new Complex *[C];
+    for(unsigned int a=0; a < C; ++a)
+      U[a]=u+a*d.n;
+
+    FFT=new fft1dMPI*[2*C];
+    FFT[0]=new fft1dMPI(d,U[0],mpi,1);
+    utils::mpiOptions options=FFT[0]->T->Options();
+    for(unsigned int a=1; a < C; ++a)
+      FFT[a]=new fft1dMPI(d,U[a],options,1);
+    for(unsigned int a=0; a < C; ++a)
+      FFT[C+a]=new fft1dMPI(d,F0,options,1);
+
+    s=BuildZeta(2*m,m,ZetaH,ZetaL,threads);
+  }
+
+  void pretransform(Complex *f);
+  void posttransform(Complex *f, Complex *u);
+
+public:
+  // F0 is an array of d.n Complex values with the alignment of the data.
+  // u is a work array of max(A,B)*d.n Complex values.
+  // A is the number of inputs.
+  // B is the number of outputs.
+  ImplicitConvolutionMPI(const utils::split& d, Complex *F0, Complex *u,
+                         const utils::mpiOptions& mpi=
+                         utils::defaultmpiOptions,
+                         unsigned int A=2, unsigned int B=1,
+                         unsigned int threads=fftw::maxthreads) :
+    ThreadBase(threads), d(d), m(d.X*d.Y), A(A), B(B), u(u),
+    allocated(false) {
+    init(F0,mpi);
+  }
+
+  ImplicitConvolutionMPI(const utils::split& d, Complex *F0,
+                         const utils::mpiOptions& mpi=
+                         utils::defaultmpiOptions,
+                         unsigned int A=2, unsigned int B=1,
+                         unsigned int threads=fftw::maxthreads) :
+    ThreadBase(threads), d(d), m(d.X*d.Y), A(A), B(B),
+    u(utils::ComplexAlign(std::max(A,B)*d.n)), allocated(true) {
+    init(F0,mpi);
+  }
+
+  virtual ~ImplicitConvolutionMPI() {
+    utils::deleteAlign(ZetaH);
+    utils::deleteAlign(ZetaL);
+    unsigned int C=std::max(A,B);
+    for(unsigned int a=0; a < 2*C; ++a)
+      delete FFT[a];
+    delete [] FFT;
+    delete [] U;
+    if(allocated) utils::deleteAlign(u);
+  }
+
+  // F is an array of max(A,B) pointers to distinct data blocks each of
+  // size d.x*d.Y, shifted by offset (contents not preserved).
+  void convolve(Complex **F, multiplier *pmult, unsigned int i=0,
+                unsigned int offset=0);
+
+  // Binary convolution:
+  void convolve(Complex *f, Complex *g) {
+    Complex *F[]={f,g};
+    convolve(F,multbinary);
+  }
+};
+
 // In-place implicitly dealiased 2D complex convolution.
 class ImplicitConvolution2MPI : public ImplicitConvolution2 {
 protected:
   utils::split d;
   utils::mpitranspose<Complex> *T,*U;
+  utils::batchtranspose<Complex> *TA,*UA; // Transposes of all fields
+  
+  void convolveBatch(Complex **F, multiplier *pmult, unsigned int offset);
 public:  
   
   void inittranspose(const utils::mpiOptions& mpioptions, Complex *work,
@@ -23,6 +114,14 @@ public:
                                        d.communicator,mpioptions,global);
     U=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.y,1,u2,work,
                                        d.communicator,T->Options(),global);
+    unsigned int C=std::max(A,B);
+    if(mpioptions.batch && C > 1) {
+      TA=new utils::batchtranspose<Complex>(d.X,d.Y,d.x,d.y,1,C,
+                                            d.communicator,mpioptions);
+      UA=new utils::batchtranspose<Complex>(d.X,d.Y,d.x,d.y,1,C,
+                                            d.communicator,mpioptions);
+    } else
+      TA=UA=NULL;
     d.Deactivate();
   }
 
@@ -65,6 +164,10 @@ public:
   }
   
   virtual ~ImplicitConvolution2MPI() {
+    if(TA) {
+      delete UA;
+      delete TA;
+    }
     delete T;
     delete U;
   }
@@ -187,21 +290,114 @@ public:
   }
 };
 
+// In-place implicitly dealiased 2D Hermitian ternary convolution.
+class ImplicitHTConvolution2MPI : public ImplicitHTConvolution2 {
+protected:
+  utils::split d;
+  utils::mpitranspose<Complex> *T,*U;
+public:
+  void inittranspose(Complex *f, const utils::mpiOptions& mpi, Complex *work,
+                     MPI_Comm global) {
+    global=global ? global : d.communicator;
+    T=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.y,1,f,work,
+                                       d.communicator,mpi,global);
+    U=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.y,1,u2,work,
+                                       d.communicator,mpi,global);
+    d.Deactivate();
+  }
+
+  // d is the split of a 2mx x (my+1) block.
+  // f is a temporary array of size d.n needed only during construction.
+  // u1, v1, and w1 are temporary arrays of size (my+1)*M*threads;
+  // u2, v2, and w2 are temporary arrays of size d.n*M.
+  // M is the number of data blocks (each corresponding to a dot product term).
+  ImplicitHTConvolution2MPI(unsigned int mx, unsigned int my,
+                            const utils::split& d, Complex *f,
+                            Complex *u1, Complex *v1, Complex *w1,
+                            Complex *u2, Complex *v2, Complex *w2,
+                            utils::mpiOptions mpi=utils::defaultmpiOptions,
+                            unsigned int M=1,
+                            unsigned int threads=fftw::maxthreads,
+                            Complex *work=NULL, MPI_Comm global=0) :
+    ImplicitHTConvolution2(mx,my,u1,v1,w1,u2,v2,w2,M,threads,
+                           convolveOptions(d.x,d.y,d.Activate(),mpi)),
+    d(d) {
+    inittranspose(f,mpi,work,global);
+  }
+
+  ImplicitHTConvolution2MPI(unsigned int mx, unsigned int my,
+                            const utils::split& d, Complex *f,
+                            utils::mpiOptions mpi=utils::defaultmpiOptions,
+                            unsigned int M=1,
+                            unsigned int threads=fftw::maxthreads,
+                            Complex *work=NULL, MPI_Comm global=0) :
+    ImplicitHTConvolution2(mx,my,M,threads,
+                           convolveOptions(d.x,d.y,d.Activate(),mpi)),
+    d(d) {
+    inittranspose(f,mpi,work,global);
+  }
+
+  virtual ~ImplicitHTConvolution2MPI() {
+    delete U;
+    delete T;
+  }
+
+  // F, G, and H are distinct pointers to M distinct data blocks each of size
+  // 2mx*d.y, shifted by offset (contents not preserved).
+  // The output is returned in F[0].
+  void convolve(Complex **F, Complex **G, Complex **H, bool symmetrize=true,
+                unsigned int offset=0);
+
+  // Constructor for special case M=1:
+  void convolve(Complex *f, Complex *g, Complex *h, bool symmetrize=true) {
+    convolve(&f,&g,&h,symmetrize);
+  }
+};
+
 // In-place implicitly dealiased 3D complex convolution.
 class ImplicitConvolution3MPI : public ImplicitConvolution3 {
 protected:
   utils::split3 d;
   fftw_plan intranspose,outtranspose;
   utils::mpitranspose<Complex> *T,*U;
+  utils::batchtranspose<Complex> *TA,*UA; // Transposes of all fields
+  
+  // The x planes are split into chunks; the transposes of chunk c+1
+  // proceed while chunk c is being convolved. Tc[p] transposes the chunks
+  // of parity p into the buffers G[2A*p+j] of d.x/chunks planes for field
+  // j (F[0..A-1] then U3[0..A-1]), allocated in g.
+  unsigned int chunks;
+  utils::chunktranspose<Complex> *Tc[2];
+  Complex *g;
+  std::vector<Complex *> G;
+  
+  void convolveBatch(Complex **F, multiplier *pmult, unsigned int offset);
+  void convolvePipeline(Complex **F, multiplier *pmult, unsigned int offset);
+  
+  bool pipelinable(unsigned int C);
+  void initchunks(unsigned int C);
+  void deletechunks();
+  void tunechunks(MPI_Comm global);
+  
 public:  
   void inittranspose(const utils::mpiOptions& mpi, Complex *work,
                      MPI_Comm global) {
+    TA=UA=NULL;
+    chunks=1;
     if(d.xy.y < d.Y) { 
       T=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.xy.y,d.z,u3,work,
                                          d.xy.communicator,mpi,global);
       U=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.xy.y,d.z,u3,work,
                                          d.xy.communicator,T->Options(),
                                          global);
+      unsigned int C=std::max(A,B);
+      if(mpi.batch && C > 1) {
+        TA=new utils::batchtranspose<Complex>(d.X,d.Y,d.x,d.xy.y,d.z,C,
+                                              d.xy.communicator,mpi);
+        UA=new utils::batchtranspose<Complex>(d.X,d.Y,d.x,d.xy.y,d.z,C,
+                                              d.xy.communicator,mpi);
+      }
+      tunechunks(global);
     } else {
       T=U=NULL;
     }
@@ -261,6 +457,11 @@ public:
   }
   
   virtual ~ImplicitConvolution3MPI() {
+    deletechunks();
+    if(TA) {
+      delete UA;
+      delete TA;
+    }
     if(T) {
       delete U;
       delete T;
@@ -411,6 +612,98 @@ public:
 };
 
 
+// In-place implicitly dealiased 3D Hermitian ternary convolution.
+class ImplicitHTConvolution3MPI : public ThreadBase {
+protected:
+  unsigned int mx,my,mz;
+  utils::split3 d;
+  unsigned int M;
+  Complex *u3,*v3,*w3;
+  bool allocated;
+  fft0bipad *xfftpad;
+  ImplicitHTConvolution2 *yzconvolve;
+  Complex **U3,**V3,**W3;
+  utils::mpitranspose<Complex> *T,*U;
+public:
+  void initpointers(Complex **&U3, Complex **&V3, Complex **&W3) {
+    U3=new Complex *[M];
+    V3=new Complex *[M];
+    W3=new Complex *[M];
+    for(unsigned int s=0; s < M; ++s) {
+      unsigned int sn=s*d.n;
+      U3[s]=u3+sn;
+      V3[s]=v3+sn;
+      W3[s]=w3+sn;
+    }
+  }
+
+  void deletepointers(Complex **&U3, Complex **&V3, Complex **&W3) {
+    delete [] W3;
+    delete [] V3;
+    delete [] U3;
+  }
+
+  void initMPI(Complex *f, const utils::mpiOptions& mpi, Complex *work,
+               Complex *work2, MPI_Comm global);
+
+  // d is the spectral split3 of a 2mx x 2my x (mz+1) block.
+  // f is a temporary array of size d.n needed only during construction.
+  // u3, v3, and w3 are temporary arrays of size d.n*M.
+  // M is the number of data blocks (each corresponding to a dot product term).
+  ImplicitHTConvolution3MPI(unsigned int mx, unsigned int my, unsigned int mz,
+                            const utils::split3& d, Complex *f,
+                            Complex *u3, Complex *v3, Complex *w3,
+                            utils::mpiOptions mpi=utils::defaultmpiOptions,
+                            unsigned int M=1,
+                            unsigned int threads=fftw::maxthreads,
+                            Complex *work=NULL, Complex *work2=NULL,
+                            MPI_Comm global=0) :
+    ThreadBase(threads), mx(mx), my(my), mz(mz), d(d), M(M),
+    u3(u3), v3(v3), w3(w3), allocated(false) {
+    initMPI(f,mpi,work,work2,global);
+  }
+
+  ImplicitHTConvolution3MPI(unsigned int mx, unsigned int my, unsigned int mz,
+                            const utils::split3& d, Complex *f,
+                            utils::mpiOptions mpi=utils::defaultmpiOptions,
+                            unsigned int M=1,
+                            unsigned int threads=fftw::maxthreads,
+                            Complex *work=NULL, Complex *work2=NULL,
+                            MPI_Comm global=0) :
+    ThreadBase(threads), mx(mx), my(my), mz(mz), d(d), M(M),
+    u3(utils::ComplexAlign(d.n*M)), v3(utils::ComplexAlign(d.n*M)),
+    w3(utils::ComplexAlign(d.n*M)), allocated(true) {
+    initMPI(f,mpi,work,work2,global);
+  }
+
+  virtual ~ImplicitHTConvolution3MPI() {
+    if(T) {
+      delete U;
+      delete T;
+    }
+    deletepointers(U3,V3,W3);
+    delete yzconvolve;
+    delete xfftpad;
+
+    if(allocated) {
+      utils::deleteAlign(w3);
+      utils::deleteAlign(v3);
+      utils::deleteAlign(u3);
+    }
+  }
+
+  // F, G, and H are distinct pointers to M distinct data blocks each of size
+  // 2mx*d.y*d.z, shifted by offset (contents not preserved).
+  // The output is returned in F[0].
+  void convolve(Complex **F, Complex **G, Complex **H, bool symmetrize=true,
+                unsigned int offset=0);
+
+  // Constructor for special case M=1:
+  void convolve(Complex *f, Complex *g, Complex *h, bool symmetrize=true) {
+    convolve(&f,&g,&h,symmetrize);
+  }
+};
+
 } // namespace fftwpp
 
 #endif
@@ -0,0 +1,101 @@
+#include "mpiconvolve.h"
+
+using namespace utils;
+
+namespace fftwpp {
+
+// The two transposes may be outstanding simultaneously, so each allocates
+// its own work array.
+void Convolution2MPI::initMPI(Complex *Gx, const mpiOptions& mpi,
+                              MPI_Comm global)
+{
+  global=global ? global : d.communicator;
+
+  unsigned int N=std::max(A,B);
+  this->Gx=new Complex*[N];
+  allocateG=!Gx;
+  for(unsigned int i=0; i < N; ++i)
+    this->Gx[i]=Gx ? Gx+i*dr.n : ComplexAlign(dr.n);
+
+  unsigned int size=fftx->workSizeW();
+  Wx=size ? ComplexAlign(size) : NULL;
+  (fftx->*fftx->Pad)(Wx);
+
+  T=new mpitranspose<Complex>(dr.X,dr.Y,dr.x,dr.y,1,Fx[0],NULL,
+                              dr.communicator,mpi,global);
+  U=new mpitranspose<Complex>(dr.X,dr.Y,dr.x,dr.y,1,this->Gx[0],NULL,
+                              dr.communicator,T->Options(),global);
+}
+
+Convolution2MPI::~Convolution2MPI()
+{
+  delete U;
+  delete T;
+  if(allocateG) {
+    unsigned int N=std::max(A,B);
+    for(unsigned int i=0; i < N; ++i)
+      deleteAlign(Gx[i]);
+  }
+  delete [] Gx;
+  if(Wx) deleteAlign(Wx);
+}
+
+// Compute residue rx of the x transforms of the A inputs, transposing each
+// block while the next one is being transformed. The last transpose is left
+// outstanding.
+void Convolution2MPI::forwardTranspose(Complex **f, Complex **F,
+                                       unsigned int rx,
+                                       mpitranspose<Complex> *T)
+{
+  for(unsigned int a=0; a < A; ++a) {
+    (fftx->*Forward)(f[a],F[a],rx,Wx);
+    if(a > 0) T->wait();
+    T->ilocalize1(F[a]);
+  }
+}
+
+void Convolution2MPI::convolveResidues(Complex **f, Complex **h,
+                                       multiplier *mult,
+                                       scaledmultiplier *smult,
+                                       unsigned int offset)
+{
+  forwardTranspose(f,Fx,0,T);
+
+  for(unsigned int rx=0; rx < Qx; ++rx) {
+    bool odd=rx % 2;
+    Complex **F=odd ? Gx : Fx;
+    mpitranspose<Complex> *t=odd ? U : T;
+
+    t->wait();
+    if(smult)
+      subconvolution(F,smult,dr.x,Ly,offset);
+    else
+      subconvolution(F,mult,dr.x,Ly,offset);
+
+    t->ilocalize0(F[0]);
+    if(rx+1 < Qx)
+      forwardTranspose(f,odd ? Fx : Gx,rx+1,odd ? T : U);
+
+    for(unsigned int b=0; b < B; ++b) {
+      t->wait();
+      if(b+1 < B) t->ilocalize0(F[b+1]);
+      (fftx->*Backward)(F[b],h[b],rx,Wx);
+    }
+    (fftx->*fftx->Pad)(Wx);
+  }
+}
+
+void Convolution2MPI::convolve(Complex **f, Complex **h, multiplier *mult,
+                               unsigned int offset)
+{
+  convolveResidues(f,h,mult,NULL,offset);
+
+  unsigned int n=Lx*d.y;
+  for(unsigned int b=0; b < B; ++b) {
+    Complex *hb=h[b];
+    for(unsigned int i=0; i < n; ++i)
+      hb[i] *= scale;
+  }
+}
+
+} // namespace fftwpp
@@ -0,0 +1,69 @@
+#ifndef __mpiconvolve_h__
+#define __mpiconvolve_h__ 1
+
+#include <mpi.h>
+#include "convolve.h"
+#include "mpigroup.h"
+
+namespace fftwpp {
+
+// Distributed hybrid dealiased 2D complex convolution.
+//
+// The inputs and outputs are distributed over the y direction as local
+// Lx x d.y slabs, where d=utils::split(Lx,Ly,communicator). Each x residue
+// is transposed to whole local rows for the y convolutions and then
+// transposed back. The return transpose of residue rx is overlapped with the
+// x transforms of residue rx+1, which uses a second set of buffers.
+//
+// fftx must be constructed with C=d.y, D=1, and the same m and q on every
+// process.
+class Convolution2MPI : public Convolution2 {
+protected:
+  utils::split d;  // Distribution of the Lx x Ly data
+  utils::split dr; // Distribution of each Sx x Ly residue
+  utils::mpitranspose<Complex> *T,*U;
+  Complex **Gx;
+  Complex *Wx;
+  bool allocateG;
+
+  void forwardTranspose(Complex **f, Complex **F, unsigned int rx,
+                        utils::mpitranspose<Complex> *T);
+
+  void convolveResidues(Complex **f, Complex **h, multiplier *mult,
+                        scaledmultiplier *smult, unsigned int offset);
+
+public:
+  // Fx and Gx are optional work arrays of size max(A,B)*dr.n.
+  Convolution2MPI(fftPad &fftx, Convolution &convolvey,
+                  const utils::split& d,
+                  utils::mpiOptions mpi=utils::defaultmpiOptions,
+                  Complex *Fx=NULL, Complex *Gx=NULL, MPI_Comm global=0) :
+    d(d) {
+    this->fftx=&fftx;
+    this->convolvey=&convolvey;
+    allocate=false;
+    Sx=fftx.outputSize()/fftx.C;
+    dr=utils::split(Sx,d.Y,d.communicator);
+    init(Fx,dr.n);
+    initMPI(Gx,mpi,global);
+  }
+
+  void initMPI(Complex *Gx, const utils::mpiOptions& mpi, MPI_Comm global);
+
+  virtual ~Convolution2MPI();
+
+  // f is a pointer to A distinct data blocks each of size Lx*d.y,
+  // shifted by offset (contents not preserved).
+  void convolve(Complex **f, Complex **h, multiplier *mult,
+                unsigned int offset=0);
+
+  // Normalize within the multiplier; the output is written only once.
+  void convolve(Complex **f, Complex **h, scaledmultiplier *mult,
+                unsigned int offset=0) {
+    convolveResidues(f,h,NULL,mult,offset);
+  }
+};
+
+} // namespace fftwpp
+
+#endif
@@ -1,8 +1,109 @@
+#include <cstring>
+#include <typeinfo>
+
 #include "mpifftw++.h"
-#include "unistd.h"
 
 namespace fftwpp {
 
+twiddles::twiddles(unsigned int N, unsigned int threads) : N(N)
+{
+  s=(unsigned int) sqrt((double) N);
+  if(s == 0) s=1;
+  unsigned int t=(N+s-1)/s;
+  double arg=2.0*acos(-1.0)/N;
+  ZetaH=utils::ComplexAlign(t);
+#ifndef FFTWPP_SINGLE_THREAD
+#pragma omp parallel for num_threads(threads)
+#endif
+  for(unsigned int a=0; a < t; ++a) {
+    double theta=s*a*arg;
+    ZetaH[a]=Complex(cos(theta),sin(theta));
+  }
+  ZetaL=utils::ComplexAlign(s);
+#ifndef FFTWPP_SINGLE_THREAD
+#pragma omp parallel for num_threads(threads)
+#endif
+  for(unsigned int b=0; b < s; ++b) {
+    double theta=b*arg;
+    ZetaL[b]=Complex(cos(theta),sin(theta));
+  }
+}
+
+void twiddles::multiply(Complex *f, unsigned int X, unsigned int y,
+                        unsigned int y0, int sign, unsigned int threads)
+{
+  // The exponent k*(y0+j) is less than N.
+#ifndef FFTWPP_SINGLE_THREAD
+#pragma omp parallel for num_threads(threads)
+#endif
+  for(unsigned int k=1; k < X; ++k) {
+    Complex *fk=f+k*y;
+    unsigned int p=k*y0;
+    for(unsigned int j=0; j < y; ++j) {
+      Complex zeta=ZetaH[p/s]*ZetaL[p % s];
+      fk[j] *= sign > 0 ? zeta : conj(zeta);
+      p += k;
+    }
+  }
+}
+
+void fft1dMPI::iForward(Complex *in, Complex *out)
+{
+  out=Setout(in,out);
+  if(!inplace) utils::copy(in,out,d.x*d.Y,threads);
+  T->ilocalize0(out);
+}
+
+void fft1dMPI::ForwardWait0(Complex *out)
+{
+  T->wait();
+  xForward->fft(out);
+  Zeta->multiply(out,d.X,d.y,d.y0,sign,threads);
+  T->ilocalize1(out);
+}
+
+void fft1dMPI::iBackward(Complex *in, Complex *out)
+{
+  out=Setout(in,out);
+  yBackward->fft(in,out);
+  T->ilocalize0(out);
+}
+
+void fft1dMPI::BackwardWait0(Complex *out)
+{
+  T->wait();
+  Zeta->multiply(out,d.X,d.y,d.y0,-sign,threads);
+  xBackward->fft(out);
+  T->ilocalize1(out);
+}
+
+void rcfft1dMPI::iForward(double *in, Complex *out)
+{
+  Tr->ilocalize0(in);
+}
+
+void rcfft1dMPI::ForwardWait0(double *in, Complex *out)
+{
+  Tr->wait();
+  xForward->fft(in,out);
+  Zeta->multiply(out,dc.X,dc.y,dc.y0,-1,threads);
+  Tc->ilocalize1(out);
+}
+
+void rcfft1dMPI::iBackward(Complex *in, double *out)
+{
+  yBackward->fft(in);
+  Tc->ilocalize0(in);
+}
+
+void rcfft1dMPI::BackwardWait0(Complex *in, double *out)
+{
+  Tc->wait();
+  Zeta->multiply(in,dc.X,dc.y,dc.y0,1,threads);
+  xBackward->fft(in,out);
+  Tr->ilocalize1(out);
+}
+
 void fft2dMPI::iForward(Complex *in, Complex *out)
 {
   out=Setout(in,out);
@@ -184,105 +285,145 @@ void rcfft3dMPI::Shift(double *f)
   }
 }
 
+// Plan from the wisdom already imported, without measuring.
+static fftw_plan WisePlan(fftw *F, Complex *in, Complex *out)
+{
+  fftw::effort |= FFTW_WISDOM_ONLY;
+  fftw_plan plan=F->Plan(in,out);
+  fftw::effort &= ~FFTW_WISDOM_ONLY;
+  return plan;
+}
+
+// Measure a new plan, returning the wisdom it generated (or NULL).
+static char *LearnPlan(fftw *F, Complex *in, Complex *out, fftw_plan& plan)
+{
+  char *experience=fftw_export_wisdom_to_string();
+  fftw_forget_wisdom();
+  plan=F->Plan(in,out);
+  char *inspiration=plan ? fftw_export_wisdom_to_string() : NULL;
+  fftw_import_wisdom_from_string(experience);
+  fftw_free(experience);
+  return inspiration;
+}
+
+// Hash of the problem being planned; processes with equal signatures are
+// assumed to need the same wisdom.
+static unsigned long PlanSignature(fftw *F, Complex *in, Complex *out)
+{
+  unsigned long h=5381;
+  for(const char *p=typeid(*F).name(); *p; ++p)
+    h=33*h+*p;
+  unsigned long v[]={F->Doubles(),F->Sign() > 0,in == out,F->Threads(),
+                     (size_t) in % 64,(size_t) out % 64};
+  for(unsigned int i=0; i < sizeof(v)/sizeof(unsigned long); ++i)
+    h=33*h+v[i];
+  return h;
+}
+
+// Merge the wisdom strings contributed by each process, either into every
+// process (all=true) or into process 0 only. Return true if any process
+// contributed.
+static bool MergeWisdom(char *inspiration, bool all, int rank, int size)
+{
+  int length=inspiration ? strlen(inspiration)+1 : 0;
+  std::vector<int> lengths(size);
+  if(all)
+    MPI_Allgather(&length,1,MPI_INT,&lengths[0],1,MPI_INT,utils::Active);
+  else
+    MPI_Gather(&length,1,MPI_INT,&lengths[0],1,MPI_INT,0,utils::Active);
+  
+  bool receive=all || rank == 0;
+  std::vector<int> displs(size);
+  int total=0;
+  if(receive) {
+    for(int i=0; i < size; ++i) {
+      displs[i]=total;
+      total += lengths[i];
+    }
+  }
+  if(all && total == 0) return false;
+  
+  std::vector<char> wisdom(std::max(total,1));
+  if(all)
+    MPI_Allgatherv(inspiration,length,MPI_CHAR,&wisdom[0],&lengths[0],
+                   &displs[0],MPI_CHAR,utils::Active);
+  else
+    MPI_Gatherv(inspiration,length,MPI_CHAR,&wisdom[0],&lengths[0],
+                &displs[0],MPI_CHAR,0,utils::Active);
+  if(receive) {
+    for(int i=0; i < size; ++i)
+      if(i != rank && lengths[i] > 0)
+        fftw_import_wisdom_from_string(&wisdom[displs[i]]);
+  }
+  return total > 0;
+}
+
+// Collective planner over utils::Active: process 0 broadcasts the saved
+// wisdom once; when any process lacks wisdom, one process per distinct
+// problem measures it, and the new wisdom is merged into every process.
 fftw_plan MPIplanner(fftw *F, Complex *in, Complex *out) 
 {
   if(utils::Active == MPI_COMM_NULL)
     return Planner(F,in,out);
-  fftw_plan plan;
-  int rank;
+  int rank,size;
   MPI_Comm_rank(utils::Active,&rank);
+  MPI_Comm_size(utils::Active,&size);
   
-  if(rank == 0) {
-    int size;
-    MPI_Comm_size(utils::Active,&size);
-    
-    static bool Wise=false;
-    bool learned=false;
-    if(!Wise)
-      LoadWisdom();
-    fftw::effort |= FFTW_WISDOM_ONLY;
-    plan=F->Plan(in,out);
-    fftw::effort &= !FFTW_WISDOM_ONLY;
-    int length=0;
-    char *experience=NULL;
-    char *inspiration=NULL;
-    if(!plan || !Wise) {
-      if(Wise) {
-        experience=fftw_export_wisdom_to_string();
-        fftw_forget_wisdom();
-      }
-      if(!plan) {
-        plan=F->Plan(in,out);
-        if(plan) learned=true;
-      }
-      if(plan)  {
-        inspiration=fftw_export_wisdom_to_string();
-        length=strlen(inspiration);
-      }
-    }
-    for(int i=1; i < size; ++i)
-      MPI_Send(&length,1,MPI_INT,i,0,utils::Active);
-    if(length > 0) {
-      MPI_Bcast(inspiration,length,MPI_CHAR,0,utils::Active);
-      if(Wise) {
-        fftw_import_wisdom_from_string(experience);
-        fftw_free(experience);
-      } else Wise=true;
-      fftw_free(inspiration);
-    }
-    int rlength[size];
-    MPI_Gather(&length,1,MPI_INT,rlength,1,MPI_INT,0,utils::Active);
-    for(int i=1; i < size; ++i) {
-      int length=rlength[i];
-      if(length > 0) {
-        learned=true;
-        char inspiration[length+1];
-        MPI_Recv(&inspiration,length,MPI_CHAR,i,0,utils::Active,MPI_STATUS_IGNORE);
-        inspiration[length]=0;
-        fftw_import_wisdom_from_string(inspiration);
-      }
-    }
-    if(learned) SaveWisdom();
-  } else {
-    int flag=false;
-    MPI_Status status;
-    while(true) {
-      MPI_Iprobe(0,0,utils::Active,&flag,&status);
-      if(flag) break;
-      usleep(10000);
-    }
-    int length;
-    MPI_Recv(&length,1,MPI_INT,0,0,utils::Active,MPI_STATUS_IGNORE);
-    if(length > 0) {
-      char inspiration[length+1];
-      MPI_Bcast(inspiration,length,MPI_CHAR,0,utils::Active);
-      inspiration[length]=0;
-      fftw_import_wisdom_from_string(inspiration);
-    }
-    fftw::effort |= FFTW_WISDOM_ONLY;
-    plan=F->Plan(in,out);
-    fftw::effort &= !FFTW_WISDOM_ONLY;
-    char *experience=NULL;
-    char *inspiration=NULL;
-    if(plan)
-      length=0;
-    else {
-      experience=fftw_export_wisdom_to_string();
-      fftw_forget_wisdom();
-      plan=F->Plan(in,out);
-      if(plan) {
-        inspiration=fftw_export_wisdom_to_string();
-        length=strlen(inspiration);
-      } else length=0;
-    }
-    MPI_Gather(&length,1,MPI_INT,NULL,1,MPI_INT,0,utils::Active);
-    if(length > 0) {
-      MPI_Send(inspiration,length,MPI_CHAR,0,0,utils::Active);
-      fftw_import_wisdom_from_string(experience);
+  static bool Wise=false;
+  int length=0;
+  char *experience=NULL;
+  if(rank == 0 && !Wise) {
+    LoadWisdom();
+    experience=fftw_export_wisdom_to_string();
+    length=strlen(experience)+1;
+  }
+  MPI_Bcast(&length,1,MPI_INT,0,utils::Active);
+  if(length > 0) {
+    if(rank == 0) {
+      MPI_Bcast(experience,length,MPI_CHAR,0,utils::Active);
       fftw_free(experience);
-      fftw_free(inspiration);
+    } else {
+      std::vector<char> wisdom(length);
+      MPI_Bcast(&wisdom[0],length,MPI_CHAR,0,utils::Active);
+      fftw_import_wisdom_from_string(&wisdom[0]);
     }
   }
+  Wise=true;
+  
+  fftw_plan plan=WisePlan(F,in,out);
+  int need=!plan;
+  int needed;
+  MPI_Allreduce(&need,&needed,1,MPI_INT,MPI_MAX,utils::Active);
+  if(!needed) return plan;
+  
+  // The lowest process with each missing signature measures it.
+  unsigned long signature=need ? PlanSignature(F,in,out) : 0;
+  std::vector<unsigned long> signatures(size);
+  MPI_Allgather(&signature,1,MPI_UNSIGNED_LONG,&signatures[0],1,
+                MPI_UNSIGNED_LONG,utils::Active);
+  bool leader=need;
+  for(int i=0; leader && i < rank; ++i)
+    if(signatures[i] == signature) leader=false;
+  
+  char *inspiration=leader ? LearnPlan(F,in,out,plan) : NULL;
+  bool learned=MergeWisdom(inspiration,true,rank,size);
+  if(inspiration) fftw_free(inspiration);
+  
+  // Distinct problems that happen to share a signature are measured locally.
+  inspiration=NULL;
+  if(need && !leader) {
+    plan=WisePlan(F,in,out);
+    if(!plan)
+      inspiration=LearnPlan(F,in,out,plan);
+  }
+  int fallback=inspiration != NULL;
+  int fallbacks;
+  MPI_Allreduce(&fallback,&fallbacks,1,MPI_INT,MPI_MAX,utils::Active);
+  if(fallbacks && MergeWisdom(inspiration,false,rank,size))
+    learned=true;
+  if(inspiration) fftw_free(inspiration);
+  
+  if(learned && rank == 0) SaveWisdom();
   return plan;
 }
 
@@ -296,4 +437,176 @@ void setMPIplanner()
   fftwpp::fftw::planner=fftwpp::MPIplanner;
 }
 
+// Return the maximum time over comm of a forward and backward fft3dMPI
+// distributed over py processes in the y direction.
+static double fft3dtime(const MPI_Comm& comm, unsigned int X, unsigned int Y,
+                        unsigned int Z, const mpiOptions& options,
+                        unsigned int py)
+{
+  MPIgroup group(comm,X,Y,Z,options,py);
+  double t=0.0;
+  if(group.rank < group.size) {
+    split3 d(X,Y,Z,group);
+    Complex *f=ComplexAlign(d.n);
+    for(unsigned int i=0; i < d.n; ++i)
+      f[i]=0.0;
+    fftwpp::fft3dMPI fft(d,f,options);
+    fft.Forward(f,f);
+    fft.Backward(f,f);
+    
+    unsigned int count=0;
+    double start=totalseconds();
+    int more=1;
+    while(more) {
+      fft.Forward(f,f);
+      fft.Backward(f,f);
+      ++count;
+      if(group.rank == 0)
+        more=totalseconds()-start < testseconds;
+      MPI_Bcast(&more,1,MPI_INT,0,group.active);
+    }
+    t=(totalseconds()-start)/count;
+    deleteAlign(f);
+  }
+  double T;
+  MPI_Allreduce(&t,&T,1,MPI_DOUBLE,MPI_MAX,comm);
+  return T;
+}
+
+unsigned int decomposition(const MPI_Comm& comm, unsigned int X,
+                           unsigned int Y, unsigned int Z,
+                           const mpiOptions& options)
+{
+  int size,rank;
+  MPI_Comm_size(comm,&size);
+  MPI_Comm_rank(comm,&rank);
+  
+  // A pencil decomposition in fft3dMPI holds one x plane per process, so
+  // the only candidate distributes Y in equal blocks over at most
+  // min(P/X,Z) processes, as in MPIgroup(comm,X,Y).
+  unsigned int P=size;
+  unsigned int pencil=0;
+  if(X <= Y) {
+    unsigned int pmax=std::min(P/X,std::min(Y,Z));
+    if(pmax > 0) pencil=ceilquotient(Y,ceilquotient(Y,pmax));
+  }
+  if(pencil < 2) return 1;
+  
+  std::string key;
+  if(transposewisdom) {
+    unsigned int layout=nodeLayout(comm);
+    int parm[]={0,0};
+    if(rank == 0) {
+      std::ostringstream buf;
+      buf << "decomposition " << X << " " << Y << " " << Z << " " << P << " "
+          << layout << " " << shmgroup << " " << options.threads << " "
+          << options.single << " " << options.a << " " << options.alltoall;
+      key=buf.str();
+      parm[0]=loadTransposeWisdom(key,parm+1,1);
+    }
+    MPI_Bcast(parm,2,MPI_INT,0,comm);
+    if(parm[0]) return parm[1];
+  }
+  
+  double slab=fft3dtime(comm,X,Y,Z,options,1);
+  double grid=fft3dtime(comm,X,Y,Z,options,pencil);
+  int py=grid < slab ? pencil : 1;
+  MPI_Bcast(&py,1,MPI_INT,0,comm);
+  
+  if(rank == 0) {
+    if(options.verbose)
+      std::cout << std::endl << "slab: " << slab << " s, " << X << "x"
+                << pencil << " pencil: " << grid << " s; using "
+                << (py == 1 ? "slab" : "pencil") << std::endl;
+    if(transposewisdom)
+      saveTransposeWisdom(key,&py,1);
+  }
+  return py;
+}
+
+// Return the maximum time over comm of a forward and backward X x Y
+// transpose in the block or balanced layout.
+static double transposetime(const MPI_Comm& comm, unsigned int X,
+                            unsigned int Y, bool balanced,
+                            const mpiOptions& options)
+{
+  int size,rank;
+  MPI_Comm_size(comm,&size);
+  MPI_Comm_rank(comm,&rank);
+  localdimension xdim(X,rank,size,balanced);
+  localdimension ydim(Y,rank,size,balanced);
+  unsigned int n=std::max(X*ydim.n,xdim.n*Y);
+  Complex *f=ComplexAlign(n);
+  for(unsigned int i=0; i < n; ++i)
+    f[i]=0.0;
+  mpitranspose<Complex> T(X,Y,xdim.n,ydim.n,1,f,NULL,comm,options);
+  T.localize1(f);
+  T.localize0(f);
+  
+  unsigned int count=0;
+  double start=totalseconds();
+  int more=1;
+  while(more) {
+    T.localize1(f);
+    T.localize0(f);
+    ++count;
+    if(rank == 0)
+      more=totalseconds()-start < testseconds;
+    MPI_Bcast(&more,1,MPI_INT,0,comm);
+  }
+  double t=(totalseconds()-start)/count;
+  deleteAlign(f);
+  double T0;
+  MPI_Allreduce(&t,&T0,1,MPI_DOUBLE,MPI_MAX,comm);
+  return T0;
+}
+
+bool balancedLayout(const MPI_Comm& comm, unsigned int X, unsigned int Y,
+                    const mpiOptions& options)
+{
+  int size,rank;
+  MPI_Comm_size(comm,&size);
+  MPI_Comm_rank(comm,&rank);
+  
+  unsigned int P=size;
+  if(X % P == 0 && Y % P == 0) return false; // Identical layouts
+  
+  // Number of processes holding data in each layout.
+  unsigned int block=std::min(ceilquotient(X,ceilquotient(X,P)),
+                              ceilquotient(Y,ceilquotient(Y,P)));
+  unsigned int even=std::min(std::min(X,Y),P);
+  if(block != even) return block < even;
+  
+  std::string key;
+  if(transposewisdom) {
+    unsigned int layout=nodeLayout(comm);
+    int parm[]={0,0};
+    if(rank == 0) {
+      std::ostringstream buf;
+      buf << "balance " << X << " " << Y << " " << P << " "
+          << layout << " " << shmgroup << " " << options.threads << " "
+          << options.single << " " << options.a << " " << options.alltoall;
+      key=buf.str();
+      parm[0]=loadTransposeWisdom(key,parm+1,1);
+    }
+    MPI_Bcast(parm,2,MPI_INT,0,comm);
+    if(parm[0]) return parm[1];
+  }
+  
+  double tblock=transposetime(comm,X,Y,false,options);
+  double teven=transposetime(comm,X,Y,true,options);
+  int balanced=teven < tblock;
+  MPI_Bcast(&balanced,1,MPI_INT,0,comm);
+  
+  if(rank == 0) {
+    if(options.verbose)
+      std::cout << std::endl << "block: " << tblock << " s, balanced: "
+                << teven << " s; using "
+                << (balanced ? "balanced" : "block") << " layout" << std::endl;
+    if(transposewisdom)
+      saveTransposeWisdom(key,&balanced,1);
+  }
+  return balanced;
+}
+
 }
@@ -10,11 +10,140 @@ namespace fftwpp {
 // In-place and out-of-place distributed FFTs. Upper case letters denote
 // global dimensions; lower case letters denote distributed dimensions: 
 
+// Twiddle factors exp(2*pi*i*p/N) of a distributed four-step FFT,
+// computed as ZetaH[p/s]*ZetaL[p%s].
+class twiddles {
+  unsigned int N,s;
+  Complex *ZetaH,*ZetaL;
+public:
+  twiddles(unsigned int N, unsigned int threads);
+  ~twiddles() {
+    utils::deleteAlign(ZetaL);
+    utils::deleteAlign(ZetaH);
+  }
+  
+  // Multiply element (k,j) of the X x y matrix f by exp(sign*2*pi*i*k*j0/N),
+  // where j0=y0+j.
+  void multiply(Complex *f, unsigned int X, unsigned int y, unsigned int y0,
+                int sign, unsigned int threads);
+};
+
+// 1D OpenMP/MPI complex in-place and out-of-place distributed FFT of
+// length nx*ny, computed with the four-step algorithm: the input, viewed as
+// an nx x ny matrix distributed over x, is transposed, transformed over x,
+// multiplied by twiddle factors, transposed back, and transformed over y.
+//
+// The input is distributed in contiguous blocks of d.x*ny values starting
+// at d.x0*ny. The output is left in transposed order: local element
+// i*ny+j holds the Fourier coefficient with index (d.x0+i)+nx*j.
+// Backward maps this order back to the natural order.
+// The arrays must be allocated as split::n Complex words.
+// The sign argument (default -1) of the constructor specifies the sign
+// of the forward transform.
+//
+// Example:
+//
+// MPIgroup group(MPI_COMM_WORLD,nx);
+// split d(nx,ny,group.active);
+// Complex *f=ComplexAlign(d.n);
+// fft1dMPI fft(d,f);
+// fft.Forward(f);
+// fft.Backward(f);
+// fft.Normalize(f);
+// deleteAlign(f);
+//
+// Double non-blocking interface:
+// fft.iForward(f);
+// User computation 0
+// fft.ForwardWait0(f);
+// User computation 1
+// fft.ForwardWait1(f);
+
+class fft1dMPI : public fftw {
+protected:
+  utils::split d;
+  mfft1d *xForward,*xBackward;
+  mfft1d *yForward,*yBackward;
+  twiddles *Zeta;
+public:
+  utils::mpitranspose<Complex> *T;
+  
+  void init(Complex *in, Complex *out, const utils::mpiOptions& options) {
+    d.Activate();
+    out=CheckAlign(in,out);
+    inplace=(in == out);
+    
+    T=new utils::mpitranspose<Complex>(d.X,d.Y,d.x,d.y,1,out,d.communicator,
+                                       options);
+    xForward=new mfft1d(d.X,sign,d.y,d.y,1,out,out,threads);
+    xBackward=new mfft1d(d.X,-sign,d.y,d.y,1,out,out,threads);
+    yForward=new mfft1d(d.Y,sign,d.x,1,d.Y,out,out,threads);
+    yBackward=new mfft1d(d.Y,-sign,d.x,1,d.Y,in,out,threads);
+    Zeta=new twiddles(d.X*d.Y,threads);
+    
+    d.Deactivate();
+  }
+  
+  fft1dMPI(const utils::split& d, Complex *in,
+           const utils::mpiOptions& options=utils::defaultmpiOptions,
+           int sign=-1) :
+    fftw(2*d.x*d.Y,sign,options.threads,d.X*d.Y), d(d) {
+    init(in,in,options);
+  }
+    
+  fft1dMPI(const utils::split& d, Complex *in, Complex *out,
+           const utils::mpiOptions& options=utils::defaultmpiOptions,
+           int sign=-1) :
+    fftw(2*d.x*d.Y,sign,options.threads,d.X*d.Y), d(d) {
+    init(in,out,options);
+  }
+  
+  virtual ~fft1dMPI() {
+    delete Zeta;
+    delete yBackward;
+    delete yForward;
+    delete xBackward;
+    delete xForward;
+    delete T;
+  }
+
+  virtual void iForward(Complex *in, Complex *out=NULL);
+  virtual void ForwardWait0(Complex *out);
+  virtual void ForwardWait1(Complex *out) {
+    T->wait();
+    yForward->fft(out);
+  }
+  void ForwardWait(Complex *out) {
+    ForwardWait0(out);
+    ForwardWait1(out);
+  }
+  void Forward(Complex *in, Complex *out=NULL) {
+    out=Setout(in,out);
+    iForward(in,out);
+    ForwardWait(out);
+  }
+  
+  virtual void iBackward(Complex *in, Complex *out=NULL);
+  virtual void BackwardWait0(Complex *out);
+  virtual void BackwardWait1(Complex *out) {
+    T->wait();
+  }
+  void BackwardWait(Complex *out) {
+    BackwardWait0(out);
+    BackwardWait1(out);
+  }
+  void Backward(Complex *in, Complex *out=NULL) {
+    out=Setout(in,out);
+    iBackward(in,out);
+    BackwardWait(out);
+  }
+};
+
 // 2D OpenMP/MPI complex in-place and out-of-place 
 // xY -> Xy
 // Fourier transform an nx*ny array, distributed first over x.
 // The array must be allocated as split::n Complex words.
-// The sign argument (default -1) of the constructor specfies the sign
+// The sign argument (default -1) of the constructor specifies the sign
 // of the forward transform.
 //
 // Example:
@@ -122,7 +251,7 @@ public:
 // xyZ -> Xyz
 // Fourier transform an nx*ny*nz array, distributed first over x and
 // then over y. The array must be allocated as split3::n Complex words.
-// The sign argument (default -1) of the constructor specfies the sign
+// The sign argument (default -1) of the constructor specifies the sign
 // of the forward transform.
 //
 // Example:
@@ -259,6 +388,118 @@ public:
   
 };
 
+// 1D OpenMP/MPI real-to-complex and complex-to-real out-of-place
+// distributed FFT of nx*ny real values, computed with the four-step
+// algorithm (cf. fft1dMPI).
+//
+// The real array in is distributed according to dr=split(nx,ny) in
+// contiguous blocks of dr.x*ny values starting at dr.x0*ny.
+// The complex array out is distributed according to dc=split(nx/2+1,ny):
+// local element i*ny+j holds the Fourier coefficient with index
+// (dc.x0+i)+nx*j. By Hermitian symmetry, these determine all nx*ny
+// coefficients.
+// The array in must be allocated as dr.n doubles and out as dc.n Complex
+// words. The input of each transform is destroyed.
+//
+// Example:
+//
+// MPIgroup group(MPI_COMM_WORLD,nx/2+1);
+// split dr(nx,ny,group.active);
+// split dc(nx/2+1,ny,group.active);
+// double *f=doubleAlign(dr.n);
+// Complex *g=ComplexAlign(dc.n);
+// rcfft1dMPI fft(dr,dc,f,g);
+// fft.Forward(f,g);
+// fft.Backward(g,f);
+// fft.Normalize(f);
+// deleteAlign(g);
+// deleteAlign(f);
+
+class rcfft1dMPI : public fftw {
+protected:
+  utils::split dr,dc; // real and complex MPI dimensions.
+  mrcfft1d *xForward;
+  mcrfft1d *xBackward;
+  mfft1d *yForward,*yBackward;
+  twiddles *Zeta;
+public:
+  utils::mpitranspose<double> *Tr;
+  utils::mpitranspose<Complex> *Tc;
+  
+  void init(double *in, Complex *out, const utils::mpiOptions& options) {
+    if((Complex *) in == out) {
+      std::cerr << "rcfft1dMPI requires distinct input and output arrays"
+                << std::endl;
+      exit(1);
+    }
+    if(dr.y != dc.y) {
+      std::cerr << "rcfft1dMPI requires dr and dc to share a communicator"
+                << std::endl;
+      exit(1);
+    }
+    dc.Activate();
+    out=CheckAlign(out,out);
+    
+    Tr=new utils::mpitranspose<double>(dr.X,dr.Y,dr.x,dr.y,1,in,
+                                       dr.communicator,options);
+    Tc=new utils::mpitranspose<Complex>(dc.X,dc.Y,dc.x,dc.y,1,out,
+                                        dc.communicator,options);
+    xForward=new mrcfft1d(dr.X,dr.y,dr.y,dc.y,1,1,in,out,threads);
+    xBackward=new mcrfft1d(dr.X,dr.y,dc.y,dr.y,1,1,out,in,threads);
+    yForward=new mfft1d(dc.Y,-1,dc.x,1,dc.Y,out,out,threads);
+    yBackward=new mfft1d(dc.Y,1,dc.x,1,dc.Y,out,out,threads);
+    Zeta=new twiddles(dr.X*dr.Y,threads);
+    
+    dc.Deactivate();
+  }
+  
+  rcfft1dMPI(const utils::split& dr, const utils::split& dc, double *in,
+             Complex *out,
+             const utils::mpiOptions& options=utils::defaultmpiOptions) :
+    fftw(dr.x*dr.Y,-1,options.threads,dr.X*dr.Y), dr(dr), dc(dc) {
+    init(in,out,options);
+  }
+  
+  virtual ~rcfft1dMPI() {
+    delete Zeta;
+    delete yBackward;
+    delete yForward;
+    delete xBackward;
+    delete xForward;
+    delete Tc;
+    delete Tr;
+  }
+  
+  virtual void iForward(double *in, Complex *out);
+  virtual void ForwardWait0(double *in, Complex *out);
+  virtual void ForwardWait1(Complex *out) {
+    Tc->wait();
+    yForward->fft(out);
+  }
+  void ForwardWait(double *in, Complex *out) {
+    ForwardWait0(in,out);
+    ForwardWait1(out);
+  }
+  void Forward(double *in, Complex *out) {
+    iForward(in,out);
+    ForwardWait(in,out);
+  }
+  
+  virtual void iBackward(Complex *in, double *out);
+  virtual void BackwardWait0(Complex *in, double *out);
+  virtual void BackwardWait1(double *out) {
+    Tr->wait();
+  }
+  void BackwardWait(Complex *in, double *out) {
+    BackwardWait0(in,out);
+    BackwardWait1(out);
+  }
+  void Backward(Complex *in, double *out) {
+    iBackward(in,out);
+    BackwardWait(in,out);
+  }
+};
+
 // 2D OpenMP/MPI real-to-complex and complex-to-real in-place and out-of-place
 // xY->Xy distributed FFT.
 //
@@ -8,6 +8,21 @@ namespace utils {
 extern MPI_Comm Active;
 void setMPIplanner();
 
+// Return the number of processes over which to distribute Y in a 3D
+// transform of an X x Y x Z array (1 for a slab decomposition), choosing
+// the faster of the slab and pencil decompositions by timing fft3dMPI.
+// The choice is cached in the transpose wisdom file.
+unsigned int decomposition(const MPI_Comm& comm, unsigned int X,
+                           unsigned int Y, unsigned int Z,
+                           const mpiOptions& options=defaultmpiOptions);
+
+// Return true if an X x Y transpose over comm should distribute X and Y in
+// balanced blocks rather than in blocks of ceilquotient(X,size). The layout
+// that leaves fewer processes idle is preferred; otherwise the faster one
+// is chosen by timing and cached in the transpose wisdom file.
+bool balancedLayout(const MPI_Comm& comm, unsigned int X, unsigned int Y,
+                    const mpiOptions& options=defaultmpiOptions);
+
 class MPIgroup {
 public:  
   int rank,size;
@@ -23,11 +38,11 @@ public:
     MPI_Comm_split(comm,rank < size,0,&active);
   }
   
-// Distribute X.
+// Distribute X. Unless balance=0, use up to X processes.
   MPIgroup(const MPI_Comm& comm, unsigned int X) {
     init(comm);
     unsigned int xblock=ceilquotient(X,size);
-    size=ceilquotient(X,xblock);
+    size=balance ? std::min((unsigned int) size,X) : ceilquotient(X,xblock);
     activate(comm);
     communicator=communicator2=MPI_COMM_NULL;
   }
@@ -52,6 +67,25 @@ public:
     }
   }
 
+// Distribute X over size/py processes and Y over py processes, where py
+// is the given value or, if py=0, the value returned by decomposition().
+// For py > 1, size/py must be at least X (one x plane per process).
+  MPIgroup(const MPI_Comm& comm, unsigned int X, unsigned int Y,
+           unsigned int Z, const mpiOptions& options, unsigned int py=0) {
+    if(py == 0) py=decomposition(comm,X,Y,Z,options);
+    init(comm);
+    unsigned int px=std::min(size/py,std::min(X,Y));
+    size=px*py;
+    
+    activate(comm);
+    if(rank < size) {
+      int p=rank % py;
+      int q=rank / py;
+      MPI_Comm_split(active,p,q,&communicator);
+      MPI_Comm_split(active,q,p,&communicator2);
+    }
+  }
+
   ~MPIgroup(){
     int final;
     MPI_Finalized(&final);
@@ -69,15 +103,18 @@ public:
 // Big letters denote global dimensions; small letters denote local dimensions.
 //            local matrix is X * y
 // local transposed matrix is x * Y
+// Balance selects the layout of non-divisible dimensions (see balance).
 class split {
 public:
   unsigned int X,Y;     // global matrix dimensions
   unsigned int x,y;     // local matrix dimensions
   unsigned int x0,y0;   // local starting values
   unsigned int n;       // total required storage (words)
+  bool balanced;        // blocks differ in length by at most one
   MPI_Comm communicator;
   split() {}
-  split(unsigned int X, unsigned int Y, MPI_Comm communicator)
+  split(unsigned int X, unsigned int Y, MPI_Comm communicator,
+        int Balance=balance)
     : X(X), Y(Y), communicator(communicator) {
     int size;
     int rank;
@@ -85,8 +122,11 @@ public:
     MPI_Comm_rank(communicator,&rank);
     MPI_Comm_size(communicator,&size);
     
-    localdimension xdim(X,rank,size);
-    localdimension ydim(Y,rank,size);
+    balanced=Balance > 0 ||
+      (Balance < 0 && balancedLayout(communicator,X,Y));
+    
+    localdimension xdim(X,rank,size,balanced);
+    localdimension ydim(Y,rank,size,balanced);
     
     x=xdim.n;
     y=ydim.n;
@@ -133,6 +173,8 @@ public:
   MPI_Comm communicator;
   MPI_Comm *XYplane;          // Used by HermitianSymmetrizeXYMPI
   int *reflect;               // Used by HermitianSymmetrizeXYMPI
+  int *exchange;              // Used by HermitianSymmetrizeXYMPI
+  Complex *buffer;            // Used by HermitianSymmetrizeXYMPI
   split3() {}
   void init(const MPIgroup& group, bool spectral) {
     xy=split(X,Y,group.communicator);
@@ -154,13 +196,15 @@ public:
   
   split3(unsigned int X, unsigned int Y, unsigned int Z,
          const MPIgroup& group, bool spectral=false) :
-    X(X), Y(Y), Y2(Y), Z(Z), communicator(group.active), XYplane(NULL) {
+    X(X), Y(Y), Y2(Y), Z(Z), communicator(group.active), XYplane(NULL),
+    reflect(NULL), exchange(NULL), buffer(NULL) {
     init(group,spectral);
   }
     
   split3(unsigned int X, unsigned int Y, unsigned int Y2, unsigned int Z,
          const MPIgroup& group, bool spectral=false) : 
-    X(X), Y(Y), Y2(Y2), Z(Z), communicator(group.active), XYplane(NULL) {
+    X(X), Y(Y), Y2(Y2), Z(Z), communicator(group.active), XYplane(NULL),
+    reflect(NULL), exchange(NULL), buffer(NULL) {
     init(group,spectral);
   }
   
@@ -174,7 +218,11 @@ public:
   }
 
   ~split3() {
-    if(XYplane && z0 == 0) delete [] reflect;
+    if(XYplane && z0 == 0) {
+      if(buffer) deleteAlign(buffer);
+      delete [] exchange;
+      delete [] reflect;
+    }
   }
   
   void show() {
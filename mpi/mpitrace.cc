@@ -0,0 +1,91 @@
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#include "mpitrace.h"
+
+namespace utils {
+
+int tracing=traceOff;
+std::vector<traceEvent> traceEvents;
+unsigned int traceLimit=1000000;
+unsigned int traceDropped=0;
+unsigned int traceCall::count=0;
+unsigned int traceCall::depth=0;
+
+void traceRecord(const char *name, const char *category, double start,
+                 double sent, double received)
+{
+  if(traceEvents.size() >= traceLimit) {
+    ++traceDropped;
+    return;
+  }
+  traceEvent e;
+  e.name=name;
+  e.category=category;
+  e.start=start;
+  e.duration=MPI_Wtime()-start;
+  e.sent=sent;
+  e.received=received;
+  e.call=traceCall::depth > 0 ? traceCall::count : 0;
+  traceEvents.push_back(e);
+}
+
+void traceClear()
+{
+  traceEvents.clear();
+  traceDropped=0;
+}
+
+void traceWrite(const std::string& prefix, MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm,&rank);
+  
+  double first=traceEvents.size() > 0 ? traceEvents[0].start : MPI_Wtime();
+  for(unsigned int i=1; i < traceEvents.size(); ++i)
+    if(traceEvents[i].start < first) first=traceEvents[i].start;
+  double origin;
+  MPI_Allreduce(&first,&origin,1,MPI_DOUBLE,MPI_MIN,comm);
+  
+  std::ostringstream buf;
+  buf << prefix << "." << rank << (tracing == traceChrome ? ".json" : ".csv");
+  std::ofstream fout(buf.str().c_str());
+  if(!fout) {
+    std::cerr << "Cannot write trace file " << buf.str() << std::endl;
+    return;
+  }
+  fout.precision(12);
+  if(traceDropped > 0)
+    std::cerr << "Rank " << rank << " dropped " << traceDropped
+              << " trace events beyond traceLimit=" << traceLimit
+              << std::endl;
+  
+  unsigned int n=traceEvents.size();
+  if(tracing == traceChrome) {
+    // Complete ("X") events with timestamps in microseconds.
+    fout << "{\"traceEvents\":[" << std::endl;
+    for(unsigned int i=0; i < n; ++i) {
+      const traceEvent& e=traceEvents[i];
+      fout << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+           << "\",\"ph\":\"X\",\"pid\":" << rank << ",\"tid\":0,\"ts\":"
+           << 1.0e6*(e.start-origin) << ",\"dur\":" << 1.0e6*e.duration
+           << ",\"args\":{\"call\":" << e.call << ",\"sent\":" << e.sent
+           << ",\"received\":" << e.received << "}}"
+           << (i+1 < n ? "," : "") << std::endl;
+    }
+    fout << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+  } else {
+    fout << "rank,call,name,category,start,duration,sent,received"
+         << std::endl;
+    for(unsigned int i=0; i < n; ++i) {
+      const traceEvent& e=traceEvents[i];
+      fout << rank << "," << e.call << "," << e.name << "," << e.category
+           << "," << e.start-origin << "," << e.duration << "," << e.sent
+           << "," << e.received << std::endl;
+    }
+  }
+  traceClear();
+}
+
+}
@@ -0,0 +1,102 @@
+#ifndef __mpitrace_h__
+#define __mpitrace_h__ 1
+
+/*
+  Per-process event tracing of MPI transposes and convolutions.
+
+  When tracing is enabled, each traceScope records the wall time of the
+  enclosing block as an event, together with the number of bytes that the
+  process sends to and receives from other processes in that block and
+  the index of the enclosing top-level convolve() call. Events are written
+  to one file per rank by traceWrite, either as CSV or in the Chrome
+  trace-event format (viewable in chrome://tracing or Perfetto).
+
+  Only the master thread of an OpenMP region records events, and at most
+  traceLimit events are kept per process; later events are counted as
+  dropped until the next traceWrite or traceClear.
+
+  When tracing is disabled, a traceScope costs a single test.
+*/
+
+#include <mpi.h>
+#include <vector>
+#include <string>
+#include "fftw++.h"
+
+namespace utils {
+
+enum {traceOff, traceCSV, traceChrome};
+extern int tracing; // Trace output format [traceOff]
+
+struct traceEvent {
+  const char *name;
+  const char *category;
+  double start;          // Wall clock time (seconds)
+  double duration;       // Seconds
+  double sent,received;  // Bytes exchanged with other processes
+  unsigned int call;     // Index of enclosing convolve() call [0=none]
+};
+
+extern std::vector<traceEvent> traceEvents;
+extern unsigned int traceLimit; // Maximum events kept per process
+extern unsigned int traceDropped; // Events dropped beyond traceLimit
+
+// Return true if the calling thread records events.
+inline bool traceThread()
+{
+  return tracing && get_thread_num() == 0;
+}
+
+void traceRecord(const char *name, const char *category, double start,
+                 double sent=0.0, double received=0.0);
+
+// Write the events recorded by each process in comm to
+// prefix.<rank>.csv or prefix.<rank>.json and clear them. Times are
+// relative to the earliest event over comm.
+void traceWrite(const std::string& prefix, MPI_Comm comm=MPI_COMM_WORLD);
+
+void traceClear();
+
+// Record the enclosing block as an event.
+class traceScope {
+  const char *name;
+  const char *category;
+  double start;
+  double sent,received;
+public:
+  traceScope(const char *name, const char *category="transpose",
+             double sent=0.0, double received=0.0) :
+    name(traceThread() ? name : NULL), category(category), start(0.0),
+    sent(sent), received(received) {
+    if(this->name) start=MPI_Wtime();
+  }
+  ~traceScope() {
+    if(name) traceRecord(name,category,start,sent,received);
+  }
+};
+
+// Record the enclosing convolve() call as an event and number the
+// top-level calls.
+class traceCall {
+  const char *name;
+  double start;
+public:
+  static unsigned int count,depth;
+  traceCall(const char *name) : name(traceThread() ? name : NULL),
+                                start(0.0) {
+    if(this->name) {
+      if(depth++ == 0) ++count;
+      start=MPI_Wtime();
+    }
+  }
+  ~traceCall() {
+    if(name) {
+      traceRecord(name,"convolve",start);
+      --depth;
+    }
+  }
+};
+
+}
+
+#endif
@@ -1,3 +1,10 @@
+#include <fstream>
+#include <map>
+#include <sched.h>
+#ifndef FFTWPP_SINGLE_THREAD
+#include <pthread.h>
+#endif
+
 #include "mpitranspose.h"
 #include "cmult-sse2.h"
 
@@ -6,8 +13,247 @@ namespace utils {
 double safetyfactor=2.0;
 bool overlap=true;
 double testseconds=0.2;
+bool persistent=true;
+unsigned int shmgroup=0;
+int balance=0;
+bool progress=false;
+double waitseconds=0.0;
+unsigned int waitcount=0;
+const char *transposewisdom="wisdomtranspose.txt";
 mpiOptions defaultmpiOptions;
 
+#ifndef FFTWPP_SINGLE_THREAD
+static pthread_mutex_t progressmutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t progresswake=PTHREAD_COND_INITIALIZER;
+static pthread_cond_t progressidle=PTHREAD_COND_INITIALIZER;
+static int progressthread=-1; // [-1=not started, 0=unavailable, 1=running]
+static unsigned int progressusers=0; // Transposes in flight
+static bool progressbusy=false; // Progress thread is inside MPI
+
+// Drive the MPI progress engine while any transpose is in flight and sleep
+// otherwise. MPI_Iprobe is used since, unlike MPI_Test, it does not touch
+// the requests that the main thread later waits on.
+static void *progressLoop(void *)
+{
+  int flag;
+  pthread_mutex_lock(&progressmutex);
+  for(;;) {
+    while(progressusers == 0)
+      pthread_cond_wait(&progresswake,&progressmutex);
+    progressbusy=true;
+    pthread_mutex_unlock(&progressmutex);
+    MPI_Iprobe(MPI_ANY_SOURCE,MPI_ANY_TAG,MPI_COMM_WORLD,&flag,
+               MPI_STATUS_IGNORE);
+    sched_yield();
+    pthread_mutex_lock(&progressmutex);
+    progressbusy=false;
+    if(progressusers == 0)
+      pthread_cond_broadcast(&progressidle);
+  }
+  return NULL;
+}
+#endif
+
+bool progressBegin()
+{
+#ifndef FFTWPP_SINGLE_THREAD
+  pthread_mutex_lock(&progressmutex);
+  if(progressthread < 0) {
+    int provided;
+    MPI_Query_thread(&provided);
+    pthread_t thread;
+    progressthread=provided == MPI_THREAD_MULTIPLE &&
+      pthread_create(&thread,NULL,progressLoop,NULL) == 0;
+    if(progressthread) pthread_detach(thread);
+  }
+  bool running=progressthread > 0;
+  if(running && progressusers++ == 0)
+    pthread_cond_signal(&progresswake);
+  pthread_mutex_unlock(&progressmutex);
+  return running;
+#else
+  return false;
+#endif
+}
+
+void progressEnd()
+{
+#ifndef FFTWPP_SINGLE_THREAD
+  pthread_mutex_lock(&progressmutex);
+  if(progressusers > 0 && --progressusers == 0) {
+    while(progressbusy)
+      pthread_cond_wait(&progressidle,&progressmutex);
+  }
+  pthread_mutex_unlock(&progressmutex);
+#endif
+}
+
+#if MPI_VERSION >= 3
+// Split comm into groups of at most shmgroup (if nonzero) processes that
+// share a node.
+static void splitNode(MPI_Comm comm, MPI_Comm *node)
+{
+  int rank;
+  MPI_Comm_rank(comm,&rank);
+  MPI_Comm shared;
+  MPI_Comm_split_type(comm,MPI_COMM_TYPE_SHARED,rank,MPI_INFO_NULL,&shared);
+  if(shmgroup > 0) {
+    int sharedrank;
+    MPI_Comm_rank(shared,&sharedrank);
+    MPI_Comm_split(shared,sharedrank/shmgroup,sharedrank,node);
+    MPI_Comm_free(&shared);
+  } else *node=shared;
+}
+#endif
+
+// Communicators, schedules, and node sizes derived from a communicator,
+// attached to it as an attribute and released with it. Schedules and node
+// sizes depend on shmgroup.
+struct commCache {
+  typedef std::map<std::pair<int,int>,MPI_Comm> splitMap;
+  splitMap splits;
+  std::map<unsigned int,std::vector<int> > schedules;
+  std::map<unsigned int,int> nodesizes;
+};
+
+static int commCacheKey=MPI_KEYVAL_INVALID;
+
+static int deleteCommCache(MPI_Comm, int, void *attr, void *)
+{
+  commCache *cache=(commCache *) attr;
+  int final;
+  MPI_Finalized(&final);
+  if(!final) {
+    for(commCache::splitMap::iterator p=cache->splits.begin();
+        p != cache->splits.end(); ++p)
+      MPI_Comm_free(&p->second);
+  }
+  delete cache;
+  return MPI_SUCCESS;
+}
+
+static commCache *getCommCache(MPI_Comm comm)
+{
+  if(commCacheKey == MPI_KEYVAL_INVALID)
+    MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN,deleteCommCache,
+                           &commCacheKey,NULL);
+  commCache *cache;
+  int found;
+  MPI_Comm_get_attr(comm,commCacheKey,&cache,&found);
+  if(!found) {
+    cache=new commCache;
+    MPI_Comm_set_attr(comm,commCacheKey,cache);
+  }
+  return cache;
+}
+
+MPI_Comm cachedSplit(MPI_Comm parent, int kind, int n)
+{
+  commCache *cache=getCommCache(parent);
+  std::pair<int,int> key(kind,n);
+  commCache::splitMap::iterator p=cache->splits.find(key);
+  if(p != cache->splits.end()) return p->second;
+  
+  int rank;
+  MPI_Comm_rank(parent,&rank);
+  int color=kind == splitFirst ? rank < n :
+    (kind == splitQuotient ? rank/n : rank % n);
+  MPI_Comm comm;
+  MPI_Comm_split(parent,color,0,&comm);
+  cache->splits[key]=comm;
+  return comm;
+}
+
+int *cachedSchedule(MPI_Comm comm)
+{
+  std::vector<int>& sched=getCommCache(comm)->schedules[shmgroup];
+  if(sched.empty()) {
+    int size;
+    MPI_Comm_size(comm,&size);
+    sched.resize(size);
+    fillnode_comm_sched(&sched[0],comm);
+  }
+  return &sched[0];
+}
+
+int nodeSize(MPI_Comm comm)
+{
+  int size=1;
+#if MPI_VERSION >= 3
+  commCache *cache=getCommCache(comm);
+  std::map<unsigned int,int>::iterator p=cache->nodesizes.find(shmgroup);
+  if(p != cache->nodesizes.end()) return p->second;
+  MPI_Comm node;
+  splitNode(comm,&node);
+  int local;
+  MPI_Comm_size(node,&local);
+  MPI_Comm_free(&node);
+  MPI_Allreduce(&local,&size,1,MPI_INT,MPI_MIN,comm);
+  cache->nodesizes[shmgroup]=size;
+#endif
+  return size;
+}
+
+unsigned int nodeLayout(MPI_Comm comm)
+{
+  int size,rank;
+  MPI_Comm_size(comm,&size);
+  MPI_Comm_rank(comm,&rank);
+  
+  int leader=rank;
+#if MPI_VERSION >= 3
+  MPI_Comm shared;
+  MPI_Comm_split_type(comm,MPI_COMM_TYPE_SHARED,rank,MPI_INFO_NULL,&shared);
+  MPI_Bcast(&leader,1,MPI_INT,0,shared);
+  MPI_Comm_free(&shared);
+#endif
+  
+  std::vector<int> leaders(rank == 0 ? size : 1);
+  MPI_Gather(&leader,1,MPI_INT,&leaders[0],1,MPI_INT,0,comm);
+  
+  // FNV-1a hash
+  unsigned int hash=2166136261u;
+  if(rank == 0) {
+    for(int i=0; i < size; ++i) {
+      hash ^= leaders[i];
+      hash *= 16777619u;
+    }
+  }
+  return hash;
+}
+
+bool loadTransposeWisdom(const std::string& key, int *parm, unsigned int count)
+{
+  std::ifstream fin(transposewisdom);
+  std::string line;
+  bool found=false;
+  size_t n=key.size();
+  std::vector<int> value(count);
+  while(getline(fin,line)) {
+    if(line.size() > n && line[n] == ' ' && line.compare(0,n,key) == 0) {
+      std::istringstream in(line.substr(n));
+      unsigned int i=0;
+      while(i < count && in >> value[i]) ++i;
+      if(i == count) {
+        for(i=0; i < count; ++i)
+          parm[i]=value[i];
+        found=true;
+      }
+    }
+  }
+  return found;
+}
+
+void saveTransposeWisdom(const std::string& key, const int *parm,
+                         unsigned int count)
+{
+  std::ofstream fout(transposewisdom,std::ios::app);
+  fout << key;
+  for(unsigned int i=0; i < count; ++i)
+    fout << " " << parm[i];
+  fout << std::endl;
+}
+
 /* Given a process which_pe and a number of processes npes, fills
    the array sched[npes] with a sequence of processes to communicate
    with for a deadlock-free, optimum-overlap all-to-all communication.
@@ -59,4 +305,321 @@ void fill1_comm_sched(int *sched, int which_pe, int npes)
 //  assert(s == npes);
 }
 
+/* Fill sched[size] with a topology-aware schedule for an all-to-all
+   communication over comm (a collective call). The processes on the same
+   node are visited first, in the order given by fill1_comm_sched. The
+   remote nodes follow in ring order starting from the next node; within
+   each remote node the starting process is staggered by the local index,
+   so that the processes of a node address distinct partners while the
+   inter-node messages stream. On a single node this reduces to
+   fill1_comm_sched.
+*/
+void fillnode_comm_sched(int *sched, MPI_Comm comm)
+{
+  int size,rank;
+  MPI_Comm_size(comm,&size);
+  MPI_Comm_rank(comm,&rank);
+
+  int leader=0;
+#if MPI_VERSION >= 3
+  MPI_Comm node;
+  splitNode(comm,&node);
+  leader=rank;
+  MPI_Bcast(&leader,1,MPI_INT,0,node);
+  MPI_Comm_free(&node);
+#endif
+  std::vector<int> leaders(size);
+  MPI_Allgather(&leader,1,MPI_INT,&leaders[0],1,MPI_INT,comm);
+
+  // Nodes are numbered in order of their lowest rank.
+  std::vector<int> nodeof(size);
+  std::vector<std::vector<int> > members;
+  for(int p=0; p < size; ++p) {
+    int k=0;
+    int nodes=members.size();
+    while(k < nodes && leaders[members[k][0]] != leaders[p]) ++k;
+    if(k == nodes) members.push_back(std::vector<int>());
+    members[k].push_back(p);
+    nodeof[p]=k;
+  }
+
+  int nodes=members.size();
+  if(nodes == 1) {
+    fill1_comm_sched(sched,rank,size);
+    return;
+  }
+
+  int k=nodeof[rank];
+  std::vector<int>& local=members[k];
+  int n=local.size();
+  int i=0;
+  while(local[i] != rank) ++i;
+
+  std::vector<int> order(n);
+  fill1_comm_sched(&order[0],i,n);
+  int s=0;
+  for(int j=0; j < n; ++j)
+    sched[s++]=local[order[j]];
+
+  for(int K=1; K < nodes; ++K) {
+    std::vector<int>& remote=members[(k+K) % nodes];
+    int r=remote.size();
+    for(int j=0; j < r; ++j)
+      sched[s++]=remote[(i+j) % r];
+  }
+}
+
+
+#if MPI_VERSION >= 3
+shmsegment::shmsegment(MPI_Comm comm, size_t bytes)
+{
+  int rank;
+  MPI_Comm_rank(comm,&rank);
+  MPI_Comm_split_type(comm,MPI_COMM_TYPE_SHARED,rank,MPI_INFO_NULL,&node);
+  MPI_Comm_rank(node,&noderank);
+  int nodesize;
+  MPI_Comm_size(node,&nodesize);
+
+  char *base;
+  MPI_Win_allocate_shared(bytes,1,MPI_INFO_NULL,node,&base,&win);
+  local.resize(nodesize);
+  for(int i=0; i < nodesize; ++i) {
+    MPI_Aint length;
+    int disp;
+    MPI_Win_shared_query(win,i,&length,&disp,&local[i]);
+  }
+  MPI_Win_lock_all(MPI_MODE_NOCHECK,win);
+}
+
+shmsegment::~shmsegment()
+{
+  int final;
+  MPI_Finalized(&final);
+  if(final) return;
+  MPI_Win_unlock_all(win);
+  MPI_Win_free(&win);
+  MPI_Comm_free(&node);
+}
+
+// Size of the flags of each process, padded to a cache line.
+static const size_t flagbytes=64;
+
+shmalltoall::shmalltoall(MPI_Comm comm, int count, shmsegment *data) :
+  data(data), count(count), epoch(0), sent(false)
+{
+  MPI_Comm_size(comm,&size);
+  MPI_Comm_rank(comm,&rank);
+
+  splitNode(comm,&node);
+  MPI_Comm_size(node,&nodesize);
+  MPI_Comm_rank(node,&noderank);
+
+  MPI_Comm_split(comm,noderank == 0 ? 0 : MPI_UNDEFINED,rank,&leaders);
+  nodes=nodeindex=0;
+  if(noderank == 0) {
+    MPI_Comm_size(leaders,&nodes);
+    MPI_Comm_rank(leaders,&nodeindex);
+  }
+  int parm[]={nodes,nodeindex};
+  MPI_Bcast(parm,2,MPI_INT,0,node);
+  nodes=parm[0];
+  nodeindex=parm[1];
+
+  nodeOf.resize(size);
+  localOf.resize(size);
+  MPI_Allgather(&nodeindex,1,MPI_INT,&nodeOf[0],1,MPI_INT,comm);
+  MPI_Allgather(&noderank,1,MPI_INT,&localOf[0],1,MPI_INT,comm);
+
+  members.resize(nodes);
+  for(int p=0; p < size; ++p)
+    members[nodeOf[p]].push_back(p);
+  for(int k=0; k < nodes; ++k) {
+    std::vector<int>& m=members[k];
+    std::vector<int> sorted(m.size());
+    for(unsigned int i=0; i < m.size(); ++i)
+      sorted[localOf[m[i]]]=m[i];
+    m=sorted;
+  }
+
+  // Locate the data segment of each process on this node.
+  MPI_Group group,shared;
+  MPI_Comm_group(node,&group);
+  MPI_Comm_group(data->node,&shared);
+  std::vector<int> ranks(nodesize),sharedranks(nodesize);
+  for(int i=0; i < nodesize; ++i)
+    ranks[i]=i;
+  MPI_Group_translate_ranks(group,nodesize,&ranks[0],shared,&sharedranks[0]);
+  MPI_Group_free(&shared);
+  MPI_Group_free(&group);
+  segment.resize(nodesize);
+  for(int i=0; i < nodesize; ++i)
+    segment[i]=data->local[sharedranks[i]];
+
+  // The nodesize x size(B) blocks bound for each remote node B are staged
+  // contiguously, so that they travel as a single message; blocks from
+  // remote nodes arrive in the same layout.
+  offset.resize(nodes);
+  size_t remote=0;
+  for(int k=0; k < nodes; ++k) {
+    offset[k]=remote;
+    if(k != nodeindex)
+      remote += (size_t) nodesize*members[k].size()*count;
+  }
+
+  MPI_Aint bytes=noderank == 0 ? flagbytes+2*remote : flagbytes;
+  char *base;
+  MPI_Win_allocate_shared(bytes,1,MPI_INFO_NULL,node,&base,&win);
+
+  std::vector<char *> local(nodesize);
+  flags.resize(nodesize);
+  for(int i=0; i < nodesize; ++i) {
+    MPI_Aint length;
+    int disp;
+    MPI_Win_shared_query(win,i,&length,&disp,&local[i]);
+    flags[i]=(volatile int *) local[i];
+  }
+  stage=local[0]+flagbytes;
+  incoming=stage+remote;
+
+  MPI_Win_lock_all(MPI_MODE_NOCHECK,win);
+  flags[noderank][ready]=flags[noderank][arrived]=flags[noderank][done]=0;
+  MPI_Win_sync(win);
+  MPI_Barrier(node);
+
+  pending.resize(nodesize);
+  if(noderank == 0)
+    request.resize(2*(nodes-1));
+}
+
+shmalltoall::~shmalltoall()
+{
+  int final;
+  MPI_Finalized(&final);
+  if(final) return;
+  MPI_Win_unlock_all(win);
+  MPI_Win_free(&win);
+  if(leaders != MPI_COMM_NULL)
+    MPI_Comm_free(&leaders);
+  MPI_Comm_free(&node);
+}
+
+// Wait until node process i has raised flag for the current exchange,
+// yielding the processor to it in case the node is oversubscribed.
+void shmalltoall::await(int i, int flag)
+{
+  while(!test(i,flag)) {
+    sched_yield();
+    MPI_Win_sync(win);
+  }
+}
+
+// Copy the blocks exchanged with each node process whose segment is ready,
+// waiting for the remaining ones if block is true.
+void shmalltoall::transfer(bool block, unsigned int threads)
+{
+  std::vector<int>& local=members[nodeindex];
+  for(int i=0; i < nodesize; ++i) {
+    if(!pending[i]) continue;
+    if(block) await(i,ready);
+    else if(!test(i,ready)) continue;
+    int P=local[i];
+    if(pull)
+      copy(segment[i]+rank*count,recvbuf+P*count,count,threads);
+    else
+      copy(sendbuf+P*count,segment[i]+rank*count,count,threads);
+    pending[i]=false;
+  }
+}
+
+// Post the aggregated messages to and from the other node leaders, once
+// every process on this node has staged its outgoing blocks.
+void shmalltoall::post()
+{
+  for(int i=1; i < nodesize; ++i)
+    await(i,ready);
+  unsigned int index=0;
+  for(int k=0; k < nodes; ++k) {
+    if(k != nodeindex) {
+      int n=nodesize*members[k].size()*count;
+      MPI_Isend(stage+offset[k],n,MPI_BYTE,k,0,leaders,&request[index+1]);
+      index += 2;
+    }
+  }
+  sent=true;
+}
+
+void shmalltoall::start(const void *sendbuf, void *recvbuf,
+                        unsigned int threads)
+{
+  this->sendbuf=(char *) sendbuf;
+  this->recvbuf=(char *) recvbuf;
+  char *own=segment[noderank];
+  pull=this->sendbuf == own;
+  if(!pull && this->recvbuf != own) {
+    std::cerr << "ERROR: shmalltoall requires a shared send or receive buffer"
+              << std::endl;
+    exit(1);
+  }
+  ++epoch;
+
+  for(int P=0; P < size; ++P) {
+    int k=nodeOf[P];
+    if(k != nodeindex)
+      copy(this->sendbuf+P*count,
+           stage+offset[k]+(noderank*members[k].size()+localOf[P])*count,
+           count,threads);
+  }
+  copy(this->sendbuf+rank*count,this->recvbuf+rank*count,count,threads);
+
+  signal(ready);
+
+  for(int i=0; i < nodesize; ++i)
+    pending[i]=i != noderank;
+  transfer(false,threads);
+
+  sent=false;
+  if(noderank == 0 && nodes > 1) {
+    unsigned int index=0;
+    for(int k=0; k < nodes; ++k) {
+      if(k != nodeindex) {
+        int n=nodesize*members[k].size()*count;
+        MPI_Irecv(incoming+offset[k],n,MPI_BYTE,k,0,leaders,&request[index]);
+        index += 2;
+      }
+    }
+    bool staged=true;
+    for(int i=1; i < nodesize; ++i)
+      if(!test(i,ready)) staged=false;
+    if(staged) post();
+  }
+}
+
+void shmalltoall::wait(unsigned int threads)
+{
+  transfer(true,threads);
+
+  if(nodes > 1) {
+    if(noderank == 0) {
+      if(!sent) post();
+      MPI_Waitall(request.size(),&request[0],MPI_STATUSES_IGNORE);
+      signal(arrived);
+    } else
+      await(0,arrived);
+
+    for(int P=0; P < size; ++P) {
+      int k=nodeOf[P];
+      if(k != nodeindex)
+        copy(incoming+offset[k]+(localOf[P]*nodesize+noderank)*count,
+             recvbuf+P*count,count,threads);
+    }
+  }
+
+  // Keep the segments and staging area intact until every node process
+  // has finished with them.
+  signal(done);
+  for(int i=0; i < nodesize; ++i)
+    await(i,done);
+}
+#endif
+
 }
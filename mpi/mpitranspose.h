@@ -35,6 +35,9 @@
 #include <cstring>
 #include <typeinfo>
 #include <cfloat>
+#include <vector>
+#include <string>
+#include <sstream>
 #include "Complex.h"
 #include "seconds.h"
 #include "Array.h"
@@ -42,14 +45,41 @@
 #include "align.h"
 #include "transposeoptions.h"
 #include "fftw++.h"
+#include "mpibenchmark.h"
+#include "mpitrace.h"
 
 namespace utils {
 
 extern double safetyfactor; // For conservative latency estimate.
 extern bool overlap; // Allow overlapped communication.
 extern double testseconds; // Limit for transpose timing tests
+extern bool persistent; // Reuse persistent point-to-point requests.
+extern unsigned int shmgroup; // Maximum ranks per shared-memory group [0=node]
+extern int balance; // Non-divisible layouts: [0=block], 1=balanced, -1=tune
+extern bool progress; // Poll MPI from a helper thread during overlapped
+                      // transposes [requires MPI_THREAD_MULTIPLE]
+extern double waitseconds; // Time spent blocked in overlapped transposes
+extern unsigned int waitcount; // Number of overlapped transposes completed
+extern const char *transposewisdom; // Tuned parameter file [NULL=disabled]
 extern mpiOptions defaultmpiOptions;
 
+// Register (unregister) a transpose in flight with the progress thread,
+// which polls MPI while any are registered. progressBegin returns false if
+// no progress thread is available; progressEnd returns once the thread has
+// left MPI.
+bool progressBegin();
+void progressEnd();
+
+// Hash of the assignment of the processes in comm to nodes (valid on rank 0).
+unsigned int nodeLayout(MPI_Comm comm);
+
+// Read the last count parameters recorded for key in the transpose wisdom
+// file.
+bool loadTransposeWisdom(const std::string& key, int *parm,
+                         unsigned int count=2);
+void saveTransposeWisdom(const std::string& key, const int *parm,
+                         unsigned int count=2);
+
 template<class T>
 inline void copy(const T *from, T *to, unsigned int length,
                  unsigned int threads=1)
@@ -84,7 +114,45 @@ inline void copyfromblock(const T *src, T *dest,
     );
 }
 
+// Convert length doubles to single precision for communication.
+inline void pack(const double *from, float *to, unsigned int length,
+                 unsigned int threads=1)
+{
+  PARALLEL(
+    for(unsigned int i=0; i < length; ++i)
+      to[i]=from[i];
+    );
+}
+
+inline void unpack(const float *from, double *to, unsigned int length,
+                   unsigned int threads=1)
+{
+  PARALLEL(
+    for(unsigned int i=0; i < length; ++i)
+      to[i]=from[i];
+    );
+}
+
 void fill1_comm_sched(int *sched, int which_pe, int npes);
+void fillnode_comm_sched(int *sched, MPI_Comm comm);
+
+// Process-wide cache of the communicators and schedules derived from a
+// communicator, so that transposes over the same communicators do not
+// repeat these collective operations. Cached objects are released when
+// the parent communicator is freed.
+
+enum {splitFirst,splitQuotient,splitRemainder};
+
+// Return MPI_Comm_split(parent,color,0), where color is rank < n
+// (splitFirst), rank/n (splitQuotient), or rank % n (splitRemainder).
+// All processes of parent must pass the same kind and n.
+MPI_Comm cachedSplit(MPI_Comm parent, int kind, int n);
+
+// Return the fillnode_comm_sched schedule of comm.
+int *cachedSchedule(MPI_Comm comm);
+
+// Smallest number of processes in comm sharing a node.
+int nodeSize(MPI_Comm comm);
 
 #if MPI_VERSION < 3
 inline int MPI_Ialltoall(void *sendbuf, int sendcount, MPI_Datatype sendtype,
@@ -94,6 +162,15 @@ inline int MPI_Ialltoall(void *sendbuf, int sendcount, MPI_Datatype sendtype,
   return MPI_Alltoall(sendbuf,sendcount,sendtype,recvbuf,recvcount,recvtype,
                       comm);
 }
+inline int MPI_Ialltoallw(void *sendbuf, int *sendcounts, int *sdispls,
+                          MPI_Datatype *sendtypes, void *recvbuf,
+                          int *recvcounts, int *rdispls,
+                          MPI_Datatype *recvtypes, MPI_Comm comm,
+                          MPI_Request *)
+{
+  return MPI_Alltoallw(sendbuf,sendcounts,sdispls,sendtypes,recvbuf,
+                       recvcounts,rdispls,recvtypes,comm);
+}
 inline void Wait(int count, MPI_Request *request, bool schedule)
 { 
   if(schedule)
@@ -116,12 +193,22 @@ inline void Wait(MPI_Request *request)
 }
 #endif
 
+// Local extent and offset of a dimension N distributed over size processes,
+// either in blocks of ceilquotient(N,size) or, if balanced, in blocks that
+// differ in length by at most one.
 class localdimension {
 public:
   int n;
   int start;
   
-  localdimension(int N, int rank, int size) {
+  localdimension(int N, int rank, int size, bool balanced=false) {
+    if(balanced) {
+      int q=N/size;
+      int r=N % size;
+      n=q+(rank < r);
+      start=q*rank+std::min(rank,r);
+      return;
+    }
     n=utils::ceilquotient(N,size);
     start=n*rank;
     int extra=N-start;
@@ -130,9 +217,102 @@ public:
   }
 };
 
+inline void Irecv(void *buf, int count, int source, MPI_Comm comm,
+                  MPI_Request *request, bool persistent=false)
+{
+  if(persistent)
+    MPI_Recv_init(buf,count,MPI_BYTE,source,0,comm,request);
+  else
+    MPI_Irecv(buf,count,MPI_BYTE,source,0,comm,request);
+}
+
+inline void Isend(void *buf, int count, int dest, MPI_Comm comm,
+                  MPI_Request *request, bool persistent=false)
+{
+  if(persistent)
+    MPI_Send_init(buf,count,MPI_BYTE,dest,0,comm,request);
+  else
+    MPI_Isend(buf,count,MPI_BYTE,dest,0,comm,request);
+}
+
+// Persistent point-to-point requests, keyed by communication phase and
+// buffer pair. Since the counts and peers of a phase never change, the
+// requests for a given pair of buffers are initialized on first use and
+// restarted with MPI_Startall on subsequent calls.
+class persistentRequests {
+  struct entry {
+    int phase;
+    const void *sendbuf,*recvbuf;
+    unsigned int n;
+    MPI_Request *request; // Layout expected by Wait
+    std::vector<MPI_Request> active;
+  };
+  std::vector<entry> cache;
+public:
+  static const unsigned int maxentries=16;
+
+  ~persistentRequests() {clear();}
+
+  // Return true if the cache can accept another buffer pair.
+  bool room() {return cache.size() < maxentries;}
+
+  // Restart the n requests for this phase and buffer pair, copying them
+  // into request. Return false if they have not yet been initialized.
+  bool start(int phase, const void *sendbuf, const void *recvbuf,
+             MPI_Request *request, unsigned int n) {
+    for(unsigned int i=0; i < cache.size(); ++i) {
+      entry& e=cache[i];
+      if(e.phase == phase && e.sendbuf == sendbuf && e.recvbuf == recvbuf) {
+        for(unsigned int j=0; j < n; ++j)
+          request[j]=e.request[j];
+        if(e.active.size() > 0)
+          MPI_Startall(e.active.size(),&e.active[0]);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Record and start the n newly initialized requests in request.
+  void save(int phase, const void *sendbuf, const void *recvbuf,
+            MPI_Request *request, unsigned int n) {
+    cache.push_back(entry());
+    entry& e=cache.back();
+    e.phase=phase;
+    e.sendbuf=sendbuf;
+    e.recvbuf=recvbuf;
+    e.n=n;
+    e.request=new MPI_Request[n];
+    for(unsigned int j=0; j < n; ++j) {
+      MPI_Request r=request[j];
+      e.request[j]=r;
+      if(r != MPI_REQUEST_NULL) e.active.push_back(r);
+    }
+    if(e.active.size() > 0)
+      MPI_Startall(e.active.size(),&e.active[0]);
+  }
+
+  void clear() {
+    int final;
+    MPI_Finalized(&final);
+    for(unsigned int i=0; i < cache.size(); ++i) {
+      entry& e=cache[i];
+      if(!final) {
+        for(unsigned int j=0; j < e.active.size(); ++j)
+          MPI_Request_free(&e.active[j]);
+      }
+      delete [] e.request;
+    }
+    cache.clear();
+  }
+};
+
+// If cache is non-NULL, the scheduled exchange uses persistent requests
+// identified by phase.
 inline int Ialltoall(void *sendbuf, int count, void *recvbuf,
                      MPI_Comm comm, MPI_Request *request, int *sched=NULL,
-                     unsigned int threads=1)
+                     unsigned int threads=1,
+                     persistentRequests *cache=NULL, int phase=0)
 {
   if(!sched)
     return MPI_Ialltoall(sendbuf == recvbuf ? MPI_IN_PLACE : sendbuf,
@@ -143,16 +323,23 @@ inline int Ialltoall(void *sendbuf, int count, void *recvbuf,
     int rank;
     MPI_Comm_size(comm,&size);
     MPI_Comm_rank(comm,&rank);
-    MPI_Request *srequest=request+size-1;
-    for(int p=0; p < size; ++p) {
-      int P=sched[p];
-      if(P != rank) {
-        int index=P < rank ? P : P-1;
-        MPI_Irecv((char *) recvbuf+P*count,count,MPI_BYTE,P,0,comm,
-                  request+index);
-        MPI_Isend((char *) sendbuf+P*count,count,MPI_BYTE,P,0,comm,
-                  srequest+index);
+    unsigned int n=2*(size-1);
+    bool started=false,init=false;
+    if(cache) {
+      started=cache->start(phase,sendbuf,recvbuf,request,n);
+      init=!started && cache->room();
+    }
+    if(!started) {
+      MPI_Request *srequest=request+size-1;
+      for(int p=0; p < size; ++p) {
+        int P=sched[p];
+        if(P != rank) {
+          int index=P < rank ? P : P-1;
+          Irecv((char *) recvbuf+P*count,count,P,comm,request+index,init);
+          Isend((char *) sendbuf+P*count,count,P,comm,srequest+index,init);
+        }
       }
+      if(init) cache->save(phase,sendbuf,recvbuf,request,n);
     }
   
     int offset=rank*count;
@@ -161,6 +348,79 @@ inline int Ialltoall(void *sendbuf, int count, void *recvbuf,
   }
 }
 
+#if MPI_VERSION >= 3
+// Memory of each process of comm, allocated in an MPI-3 shared-memory
+// window so that processes sharing a node can address it directly.
+class shmsegment {
+public:
+  MPI_Comm node;    // Processes sharing memory with this one
+  MPI_Win win;
+  std::vector<char *> local; // Segment of each node process
+  int noderank;
+  shmsegment(MPI_Comm comm, size_t bytes);
+  ~shmsegment();
+  void *base() {return local[noderank];}
+};
+
+// Hierarchical all-to-all exchange of count bytes between every pair of
+// processes in comm. Either the send or the receive buffer must be this
+// process's segment of data: blocks for processes on the same node are
+// then copied once, directly from (to) the segment of the peer, as soon as
+// the peer flags that its segment is ready. Blocks bound for another node
+// are aggregated by the node leader, so that a single message per node
+// pair is sent.
+class shmalltoall {
+  MPI_Comm node;     // Processes sharing memory with this one
+  MPI_Comm leaders;  // One process per node, ranked by node index
+  MPI_Win win;       // Flags and staging area
+  shmsegment *data;
+  int size,rank;
+  int nodesize,noderank;
+  int nodes,nodeindex;
+  int count;
+  int epoch;                        // Number of exchanges started
+  bool pull;                        // Sending from the shared segment
+  bool sent;                        // Leader has posted its sends
+  std::vector<int> nodeOf;          // Node index of each process
+  std::vector<int> localOf;         // Rank of each process within its node
+  std::vector<std::vector<int> > members; // Processes of each node
+  std::vector<char *> segment;      // Data segment of each node process
+  std::vector<volatile int *> flags; // ready,arrived,done of each process
+  std::vector<size_t> offset;       // Staging/receive offset of each node
+  std::vector<bool> pending;        // Node processes not yet exchanged
+  char *stage;                      // Outgoing blocks, by destination node
+  char *incoming;                   // Incoming blocks, by source node
+  std::vector<MPI_Request> request;
+  char *sendbuf,*recvbuf;
+
+  enum {ready,arrived,done};
+  void sync() {
+    MPI_Win_sync(win);
+    MPI_Win_sync(data->win);
+  }
+  void signal(int flag) {
+    sync();
+    flags[noderank][flag]=epoch;
+    sync();
+  }
+  bool test(int i, int flag) {
+    if(flags[i][flag] < epoch) return false;
+    sync();
+    return true;
+  }
+  void await(int i, int flag);
+  void transfer(bool block, unsigned int threads);
+  void post();
+public:
+  shmalltoall(MPI_Comm comm, int count, shmsegment *data);
+  ~shmalltoall();
+
+  // Start exchanging the size blocks of sendbuf into recvbuf.
+  void start(const void *sendbuf, void *recvbuf, unsigned int threads=1);
+  void wait(unsigned int threads=1);
+};
+#endif
+
 template<class T>
 class mpitranspose {
 private:
@@ -176,6 +436,8 @@ private:
   unsigned int n0,m0;
   unsigned int np,mp;
   int mlast,nlast,last;
+  int nfull,mfull; // Number of processes with n0 rows (m0 columns)
+  bool balanced;
   unsigned int threads;
   unsigned int allocated;
   MPI_Request *request;
@@ -198,7 +460,17 @@ private:
   bool uniform;
   bool subblock;
   bool compact;
+  bool datatype;
+  bool packed; // Communicate in single precision
+  MPI_Datatype blocktype; // m x L block of each of n rows of an n x M matrix
   bool schedule;
+  bool polling; // Registered with the progress thread
+  persistentRequests Persistent;
+#if MPI_VERSION >= 3
+  shmsegment *Shared; // Work array shared with the processes on this node
+  shmalltoall *Shm1,*Shm2;
+#endif
+  enum {inSplit2,inBlock,inSplit,outSplit,outBlock,outSplit2};
 public:
 
   mpiOptions Options() {return options;}
@@ -208,98 +480,31 @@ public:
     return usize <= N && usize <= M && N % usize == 0 && M % usize == 0;
   }
   
-  void poll(T *sendbuf, T *recvbuf, unsigned int N) {
-    unsigned int sN=sizeof(T)*N;
-    MPI_Alltoall(sendbuf == recvbuf ? MPI_IN_PLACE : sendbuf,
-                 sN,MPI_BYTE,recvbuf,sN,MPI_BYTE,split);
-  }
-  
   // Estimate typical bandwidth saturation message size
   double Latency() {
     if(size == 1) return 0.0;
     if(latency >= 0) return latency;
     
     int b=sqrt(size)+0.5;
-    MPI_Comm_split(communicator,rank/b,0,&split);
-    MPI_Comm_size(split,&splitsize);
-    MPI_Comm_rank(split,&splitrank);
-    
-    unsigned int N1=2;
-    unsigned int N2=10000;
-    T send[N2*splitsize];
-    T recv[N2*splitsize];
-    for(unsigned int i=0; i < N2; ++i)
-      send[N2*splitrank+i]=0.0;
-    unsigned int M=1000;
-    double T1=0.0, T2=0.0;
-    poll(send,recv,N1);
-    poll(send,recv,N2);
-    for(unsigned int i=0; i < M; ++i) {
-      MPI_Barrier(split);
-      double t0=utils::totalseconds();
-      poll(send,recv,N1);
-      MPI_Barrier(split);
-      double t1=utils::totalseconds();
-      poll(send,recv,N2);
-      MPI_Barrier(split);
-      double t2=utils::totalseconds();
-      T1 += t1-t0;
-      T2 += t2-t1;
-    }
-    latency=std::max(T1*(N2-N1)/(T2-T1)-N1,0.0)*sizeof(T);
+    MPI_Comm split=cachedSplit(communicator,splitQuotient,b);
+    commbenchmark bench(split,10000*sizeof(T),2*sizeof(T));
+    latency=bench.crossover();
     if(globalrank == 0 && options.verbose)
       std::cout << std::endl << "latency=" << latency << std::endl;
-    MPI_Comm_free(&split); 
     return latency;
   }
 
-  void setup(T *data, MPI_Comm Communicator) {
-    if(N < n) Array::ArrayExit("N must be >= n");
-    if(M < m) Array::ArrayExit("M must be >= m");
-
-    threads=options.threads;
-    MPI_Comm_size(Communicator,&size);
-    MPI_Comm_rank(Communicator,&rank);
-    
-    MPI_Comm_rank(global,&globalrank);
-    
-    n0=localdimension(N,0,size).n;
-    nlast=std::min((int) utils::ceilquotient(N,n0),size)-1;
-    np=localdimension(N,nlast,size).n;
-    
-    m0=localdimension(M,0,size).n;
-    mlast=std::min((int) utils::ceilquotient(M,m0),size)-1;
-    mp=localdimension(M,mlast,size).n;
-    
-    allocated=0;
-    if(size == 1) {
-      a=1;
-      subblock=false;
-      return;
-    }
-    
-    int Pbar=std::min(nlast+(n0 == np),mlast+(m0 == mp));
-    size=std::max(nlast+1,mlast+1);
-    MPI_Comm_split(Communicator,rank < size,0,&communicator);
-    
-    bool Uniform=divisible(size,M,N);
-    
-    int start=0,stop=Uniform ? 2 : 1;
-    if(options.alltoall > stop) options.alltoall=stop;
-    if(options.alltoall >= 0)
-      start=stop=options.alltoall;
+  // Select the block divisor a and the alltoall algorithm.
+  // Besides a < alimit, the divisor anode that makes b the number of
+  // processes per node is timed, so that the outer exchange of the
+  // two-stage transpose crosses nodes with one message per node pair.
+  void tune(T *data, bool Uniform, int Pbar, int start, int stop) {
     int Alltoall=1;
-    if(options.a >= size)
-      options.a=-1;
-      
-    if(globalrank == 0 && options.verbose)
-      std::cout << std::endl << "Initializing " << N << "x" << M
-                << " transpose of " << L*sizeof(T) << "-byte elements over " 
-                << size << " processes." << std::endl;
-      
     int alimit;
+    int anode=0;
     
     if(options.a <= 0) {
+      int ppn=nodeSize(communicator);
       double latency=safetyfactor*Latency();
       if(globalrank == 0) {
         if(N*M*L*sizeof(T) < latency*Pbar*Pbar) {
@@ -315,13 +520,22 @@ public:
           alimit=2;
           options.a=1;
         }
+        if(ppn > 1 && ppn < Pbar && Pbar % ppn == 0 && Pbar/ppn >= alimit)
+          anode=Pbar/ppn;
       }
       MPI_Bcast(&alimit,1,MPI_UNSIGNED,0,global);
       MPI_Bcast(&options.a,1,MPI_INT,0,global);
+      MPI_Bcast(&anode,1,MPI_INT,0,global);
     } else alimit=options.a+1;
     
     int astart=options.a;
-    if(alimit > astart+1 || stop-start >= 1) {
+    std::vector<int> candidates;
+    for(a=astart; a < alimit; a++)
+      candidates.push_back(a);
+    if(anode > 0)
+      candidates.push_back(anode);
+    
+    if(candidates.size() > 1 || stop-start >= 1) {
       if(globalrank == 0 && options.verbose)
         std::cout << std::endl << "Timing:" << std::endl;
       
@@ -331,19 +545,26 @@ public:
           std::cout << "alltoall=" << alltoall << std::endl;
         unsigned int maxscore=0;
         // Only consider a,b values that yield largest possible submatrix.
-        for(a=std::max(2,astart); a < alimit; a++) {
+        for(unsigned int i=0; i < candidates.size(); ++i) {
+          a=candidates[i];
+          if(a < 2) continue;
           b=Pbar/a;
           unsigned int ab=a*b;
           unsigned int score=ab*(N/ab)*ab*(M/ab);
           if(score > maxscore) maxscore=score;
         }
-        for(a=astart; a < alimit; a++) {
+        for(unsigned int i=0; i < candidates.size(); ++i) {
+          a=candidates[i];
           b=Pbar/a;
           unsigned int ab=a*b;
           if(a > 1 && ab*(N/ab)*ab*(M/ab) < maxscore) continue;
           options.alltoall=alltoall;
           uniform=Uniform && a*b == size;
-          if(start < 2 && alltoall == 2 && !Uniform) continue;
+          if(start < 2 && alltoall >= 2 && !Uniform) continue;
+#if MPI_VERSION < 3
+          if(start < stop && alltoall == 3) continue;
+#endif
+          if(start < stop && alltoall == 4 && a > 1) continue;
           init(data);
           double t=time(data);
           deallocate();
@@ -363,6 +584,131 @@ public:
       options.a=parm[0];
       options.alltoall=parm[1];
     }
+  }
+
+  // Key identifying the transpose geometry and process layout; the
+  // tuned parameters are applied to every process in global.
+  std::string wisdomKey() {
+    unsigned int layout=nodeLayout(global);
+    if(globalrank != 0) return "";
+    int globalsize;
+    MPI_Comm_size(global,&globalsize);
+    std::ostringstream key;
+    key << N << " " << M << " " << n << " " << m << " " << balanced << " "
+        << L << " "
+        << sizeof(T) << " " << size << " " << globalsize << " " << layout
+        << " " << shmgroup << " " << threads << " " << options.single << " "
+        << options.a << " " << options.alltoall;
+    return key.str();
+  }
+
+  // Restore previously tuned parameters from the transpose wisdom file.
+  bool recall(const std::string& key) {
+    int parm[]={0,0,0};
+    if(globalrank == 0)
+      parm[0]=loadTransposeWisdom(key,parm+1);
+    MPI_Bcast(parm,3,MPI_INT,0,global);
+    if(!parm[0]) return false;
+    options.a=parm[1];
+    options.alltoall=parm[2];
+    if(globalrank == 0 && options.verbose)
+      std::cout << std::endl << "Using transpose wisdom from "
+                << transposewisdom << std::endl;
+    return true;
+  }
+  
+  void setup(T *data, MPI_Comm Communicator) {
+    if(N < n) Array::ArrayExit("N must be >= n");
+    if(M < m) Array::ArrayExit("M must be >= m");
+
+    threads=options.threads;
+    polling=false;
+    MPI_Comm_size(Communicator,&size);
+    MPI_Comm_rank(Communicator,&rank);
+    
+    MPI_Comm_rank(global,&globalrank);
+    
+    // Detect a balanced distribution of N and M.
+    balanced=false;
+    if(size > 1) {
+      int aligned=localdimension(N,rank,size).n == (int) n &&
+        localdimension(M,rank,size).n == (int) m;
+      int Aligned;
+      MPI_Allreduce(&aligned,&Aligned,1,MPI_INT,MPI_MIN,Communicator);
+      balanced=!Aligned;
+    }
+    
+    n0=localdimension(N,0,size,balanced).n;
+    if(balanced) {
+      nlast=std::min((int) N,size)-1;
+      nfull=N % size ? N % size : nlast+1;
+    } else
+      nfull=nlast=std::min((int) utils::ceilquotient(N,n0),size)-1;
+    np=localdimension(N,nlast,size,balanced).n;
+    
+    m0=localdimension(M,0,size,balanced).n;
+    if(balanced) {
+      mlast=std::min((int) M,size)-1;
+      mfull=M % size ? M % size : mlast+1;
+    } else
+      mfull=mlast=std::min((int) utils::ceilquotient(M,m0),size)-1;
+    mp=localdimension(M,mlast,size,balanced).n;
+    
+    allocated=0;
+    if(size == 1) {
+      a=1;
+      subblock=false;
+      return;
+    }
+    
+    int Pbar=std::min(nfull+(nfull == nlast && n0 == np),
+                      mfull+(mfull == mlast && m0 == mp));
+    size=std::max(nlast+1,mlast+1);
+    communicator=cachedSplit(Communicator,splitFirst,size);
+    
+    bool Uniform=divisible(size,M,N);
+    
+    int start=0,stop=Uniform ? 4 : 1;
+    if(options.single) {
+      if(sizeof(T) % sizeof(double))
+        Array::ArrayExit("single-precision communication requires "
+                         "double-precision data");
+      // Packing is fused into the a=1 local transposes.
+      if(Uniform) {
+        options.a=1;
+        stop=1;
+      } else {
+        // Non-uniform layouts are not packed; Options() reflects this.
+        if(globalrank == 0 && options.verbose)
+          std::cout << std::endl << "Non-uniform " << N << "x" << M
+                    << " layout: communicating in double precision."
+                    << std::endl;
+        options.single=false;
+      }
+    }
+    if(options.alltoall > stop) options.alltoall=stop;
+    if(options.alltoall >= 0)
+      start=stop=options.alltoall;
+    if(options.a >= size)
+      options.a=-1;
+      
+    if(globalrank == 0 && options.verbose)
+      std::cout << std::endl << "Initializing " << N << "x" << M
+                << " transpose of " << L*sizeof(T) << "-byte elements over " 
+                << size << " processes." << std::endl;
+      
+    if(options.a <= 0 || start < stop) {
+      if(transposewisdom) {
+        std::string key=wisdomKey();
+        if(!recall(key)) {
+          tune(data,Uniform,Pbar,start,stop);
+          if(globalrank == 0) {
+            int parm[]={options.a,options.alltoall};
+            saveTransposeWisdom(key,parm);
+          }
+        }
+      } else tune(data,Uniform,Pbar,start,stop);
+    }
     
     a=options.a;
     b=a > 1 || Uniform ? Pbar/a : Pbar+1; 
@@ -435,8 +781,19 @@ public:
   
   void init(T *data) {
     compact=uniform && options.alltoall == 2;
+    datatype=uniform && a == 1 && options.alltoall == 4;
+    packed=uniform && a == 1 && options.single && options.alltoall <= 1;
+    
+#if MPI_VERSION >= 3
+    // The shared-memory exchanges send from or receive into the work array.
+    Shared=uniform && options.alltoall == 3 ?
+      new shmsegment(communicator,std::max(n*M,N*m)*L*sizeof(T)) : NULL;
+#endif
     
     if(compact) work=data;
+#if MPI_VERSION >= 3
+    else if(Shared) work=(T *) Shared->base();
+#endif
     else {
       if(work == NULL) {
         allocated=std::max(n*M,N*m)*L;
@@ -446,7 +803,16 @@ public:
     
     subblock=a > 1 && rank < a*b;
     
-    if(uniform) {
+    if(datatype) {
+      MPI_Datatype vector;
+      int S=sizeof(T)*L;
+      MPI_Type_vector(n,m*S,M*S,MPI_BYTE,&vector);
+      MPI_Type_create_resized(vector,0,m*S,&blocktype);
+      MPI_Type_commit(&blocktype);
+      MPI_Type_free(&vector);
+    }
+    
+    if(uniform && !datatype && !packed) {
       Tin1=new fftwpp::Transpose(b,n*a,m*L,data,work,threads);
       Tout1=new fftwpp::Transpose(n*a,b,m*L,data,work,threads);
     } else {
@@ -465,8 +831,8 @@ public:
     if(uniform)
       splitv=communicator;
     else {
-      last=std::min(nlast,mlast);
-      MPI_Comm_split(communicator,rank < last,0,&splitv);
+      last=std::min(nfull,mfull);
+      splitv=cachedSplit(communicator,splitFirst,last);
     }
     
     if(a == 1) {
@@ -474,14 +840,14 @@ public:
       splitsize=split2size=size;
       splitrank=split2rank=rank;
     } else {
-      MPI_Comm_split(communicator,rank < a*b,0,&block);
+      block=cachedSplit(communicator,splitFirst,a*b);
       
       if(rank < a*b) {
-        MPI_Comm_split(block,rank/b,0,&split);
+        split=cachedSplit(block,splitQuotient,b);
         MPI_Comm_size(split,&splitsize);
         MPI_Comm_rank(split,&splitrank);
       
-        MPI_Comm_split(block,rank % b,0,&split2);
+        split2=cachedSplit(block,splitRemainder,b);
         MPI_Comm_size(split2,&split2size);
         MPI_Comm_rank(split2,&split2rank);
       } else {
@@ -492,16 +858,23 @@ public:
     }
     
     schedule=!options.alltoall || (!uniform && a > 1);
+    
+#if MPI_VERSION >= 3
+    if(uniform && options.alltoall == 3) {
+      Shm2=new shmalltoall(split2,n*m*sizeof(T)*(a > 1 ? b : a)*L,Shared);
+      Shm1=subblock ? new shmalltoall(split,n*m*sizeof(T)*a*L,Shared) : NULL;
+    } else
+      Shm1=Shm2=NULL;
+#endif
+    
     if(schedule) {
       Request=new MPI_Request[2*(std::max(splitsize,split2size)-1)];
       if(!uniform)
         request=new MPI_Request[2*Size(a > 1 ? a*b : 0)];
     
       if(uniform || subblock) {
-        sched2=new int[split2size];
-        fill1_comm_sched(sched2,split2rank,split2size);
-        sched1=new int[splitsize];
-        fill1_comm_sched(sched1,splitrank,splitsize);
+        sched2=cachedSchedule(split2);
+        sched1=cachedSchedule(split);
       } else
         sched1=sched2=sched;
     } else {
@@ -511,46 +884,39 @@ public:
         request=new MPI_Request[2*Size(last)+1];
     }
     
-    if(!uniform) {
-      sched=new int[size];
-      fill1_comm_sched(sched,rank,size);
-    }
+    if(!uniform)
+      sched=cachedSchedule(communicator);
   }
   
   void deallocate() {
     if(size == 1) return;
     
+    Persistent.clear();
+    if(datatype) {
+      int final;
+      MPI_Finalized(&final);
+      if(!final) MPI_Type_free(&blocktype);
+    }
+#if MPI_VERSION >= 3
+    if(Shm1) delete Shm1;
+    if(Shm2) delete Shm2;
+    if(Shared) {
+      delete Shared;
+      work=NULL;
+    }
+#endif
+
     if(compact) work=NULL;
     else if(allocated) {
       Array::deleteAlign(work,allocated);
       work=NULL;
       allocated=0;
     }
-      
-    if(schedule) {
-      if(uniform || subblock) {
-        delete [] sched1;
-        delete [] sched2;
-      }
-    }
     
+    // The communicators and schedules are owned by the cache.
     delete [] Request;
-    if(!uniform) {
-      delete [] sched;
+    if(!uniform)
       delete [] request;
-    }
-    
-    if(a > 1) {
-      int final;
-      MPI_Finalized(&final);
-      if(!final) {
-        if(rank < a*b) {
-          MPI_Comm_free(&split2); 
-          MPI_Comm_free(&split); 
-        }
-        MPI_Comm_free(&block); 
-      }
-    }
 
     if(Tout2) delete Tout2;
     if(Tin2) delete Tin2;
@@ -559,11 +925,62 @@ public:
   }
   
   ~mpitranspose() {
+    unpoll();
     deallocate();
   }
   
-  int ni(int P) {return P < nlast ? n0 : (P == nlast ? np : 0);}
-  int mi(int P) {return P < mlast ? m0 : (P == mlast ? mp : 0);}
+  // Restart the persistent requests for this phase and buffer pair, if
+  // available. Otherwise set init if new persistent requests should be
+  // initialized and return false.
+  bool restart(int phase, const void *sendbuf, const void *recvbuf,
+               MPI_Request *request, unsigned int n, bool& init) {
+    init=false;
+    if(!persistent) return false;
+    if(Persistent.start(phase,sendbuf,recvbuf,request,n)) return true;
+    init=Persistent.room();
+    return false;
+  }
+
+  persistentRequests *cache() {return persistent ? &Persistent : NULL;}
+
+  // Single-precision send and receive buffers, sharing the work array.
+  float *sendf() {return (float *) work;}
+  float *recvf() {return (float *) work+N*m*L*(sizeof(T)/sizeof(double));}
+  
+  // Exchange the blocks of sendbuf over split2 (split if inner is true).
+  void exchange(void *sendbuf, void *recvbuf, bool inner, int phase) {
+#if MPI_VERSION >= 3
+    shmalltoall *shm=inner ? Shm1 : Shm2;
+    if(shm) {
+      shm->start(sendbuf,recvbuf,threads);
+      return;
+    }
+#endif
+    if(inner)
+      Ialltoall(sendbuf,n*m*sizeof(T)*a*L,recvbuf,split,Request,sched1,
+                threads,cache(),phase);
+    else
+      Ialltoall(sendbuf,n*m*sizeof(T)*(a > 1 ? b : a)*L,recvbuf,split2,
+                Request,sched2,threads,cache(),phase);
+  }
+
+  void complete(bool inner) {
+#if MPI_VERSION >= 3
+    shmalltoall *shm=inner ? Shm1 : Shm2;
+    if(shm) {
+      shm->wait(threads);
+      return;
+    }
+#endif
+    Wait(2*((inner ? splitsize : split2size)-1),Request,schedule);
+  }
+  
+  int ni(int P) {return P < nfull ? n0 : (P <= nlast ? np : 0);}
+  int mi(int P) {return P < mfull ? m0 : (P <= mlast ? mp : 0);}
+  
+  // Offset of the first row (column) of process P.
+  int nstart(int P) {return P < nfull ? n0*P : n0*nfull+np*(P-nfull);}
+  int mstart(int P) {return P < mfull ? m0*P : m0*mfull+mp*(P-mfull);}
   
   void Ialltoallout(void* sendbuf, void *recvbuf, int start,
                     unsigned int threads) {
@@ -571,28 +988,31 @@ public:
     int S=sizeof(T)*L;
     int nS=n*S;
     int mS=m*S;
-    int nm0=nS*m0;
-    int mn0=mS*n0;
-    for(int p=0; p < size; ++p) {
-      int P=sched[p];
-      if(P != rank && (rank >= start || P >= start)) {
-        int index=rank >= start ? (P < rank ? P : P-1) : P-start;
-        int count=mS*ni(P);
-        if(count > 0)
-          MPI_Irecv((char *) recvbuf+mn0*P,count,MPI_BYTE,P,0,communicator,
-                    request+index);
-        else request[index]=MPI_REQUEST_NULL;
-        count=nS*mi(P);
-        if(count > 0)
-          MPI_Isend((char *) sendbuf+nm0*P,count,MPI_BYTE,P,0,communicator,
-                    srequest+index);
-        else srequest[index]=MPI_REQUEST_NULL;
+    bool init;
+    if(!restart(outBlock,sendbuf,recvbuf,request,2*Size(start),init)) {
+      for(int p=0; p < size; ++p) {
+        int P=sched[p];
+        if(P != rank && (rank >= start || P >= start)) {
+          int index=rank >= start ? (P < rank ? P : P-1) : P-start;
+          int count=mS*ni(P);
+          if(count > 0)
+            Irecv((char *) recvbuf+mS*nstart(P),count,P,communicator,
+                  request+index,init);
+          else request[index]=MPI_REQUEST_NULL;
+          count=nS*mi(P);
+          if(count > 0)
+            Isend((char *) sendbuf+nS*mstart(P),count,P,communicator,
+                  srequest+index,init);
+          else srequest[index]=MPI_REQUEST_NULL;
+        }
       }
+      if(init)
+        Persistent.save(outBlock,sendbuf,recvbuf,request,2*Size(start));
     }
 
     if(rank >= start)
-      copy((char *) sendbuf+nm0*rank,(char *) recvbuf+mn0*rank,nS*mi(rank),
-           threads);
+      copy((char *) sendbuf+nS*mstart(rank),(char *) recvbuf+mS*nstart(rank),
+           nS*mi(rank),threads);
   }
 
   void Ialltoallin(void* sendbuf, void *recvbuf, int start,
@@ -601,32 +1021,71 @@ public:
     int S=sizeof(T)*L;
     int nS=n*S;
     int mS=m*S;
-    int nm0=nS*m0;
-    int mn0=mS*n0;
-    for(int p=0; p < size; ++p) {
-      int P=sched[p];
-      if(P != rank && (rank >= start || P >= start)) {
-        int index=rank >= start ? (P < rank ? P : P-1) : P-start;
-        int count=nS*mi(P);
-        if(count > 0)
-          MPI_Irecv((char *) recvbuf+nm0*P,nS*mi(P),MPI_BYTE,P,0,communicator,
-                    request+index);
-        else request[index]=MPI_REQUEST_NULL;
-        count=mS*ni(P);
-        if(count > 0)
-          MPI_Isend((char *) sendbuf+mn0*P,mS*ni(P),MPI_BYTE,P,0,communicator,
-                    srequest+index);
-        else srequest[index]=MPI_REQUEST_NULL;
+    bool init;
+    if(!restart(inBlock,sendbuf,recvbuf,request,2*Size(start),init)) {
+      for(int p=0; p < size; ++p) {
+        int P=sched[p];
+        if(P != rank && (rank >= start || P >= start)) {
+          int index=rank >= start ? (P < rank ? P : P-1) : P-start;
+          int count=nS*mi(P);
+          if(count > 0)
+            Irecv((char *) recvbuf+nS*mstart(P),count,P,communicator,
+                  request+index,init);
+          else request[index]=MPI_REQUEST_NULL;
+          count=mS*ni(P);
+          if(count > 0)
+            Isend((char *) sendbuf+mS*nstart(P),count,P,communicator,
+                  srequest+index,init);
+          else srequest[index]=MPI_REQUEST_NULL;
+        }
       }
+      if(init)
+        Persistent.save(inBlock,sendbuf,recvbuf,request,2*Size(start));
     }
 
     if(rank >= start)
-      copy((char *) sendbuf+mn0*rank,(char *) recvbuf+nm0*rank,mS*ni(rank),
-           threads);
+      copy((char *) sendbuf+mS*nstart(rank),(char *) recvbuf+nS*mstart(rank),
+           mS*ni(rank),threads);
   }
 
+  void localtranspose(fftwpp::Transpose *Tr, T *in, T *out) {
+    traceScope trace("Transpose","local");
+    Tr->transpose(in,out);
+  }
+  
+  // Bytes sent to and received from each other process in the outer
+  // (inner if inner=true) exchange of a two-stage or uniform transpose.
+  double exchangeBytes(bool inner) {
+    double S=packed ? 0.5*sizeof(T)*L : sizeof(T)*L;
+    return inner ? n*m*S*a*(splitsize-1) :
+      n*m*S*(a > 1 ? b : a)*(split2size-1);
+  }
+  
+  // Bytes sent and received in the first exchange of an inphase (in=true)
+  // or outphase transpose.
+  void bytes0(bool in, double& sent, double& received) {
+    if(size == 1 || rank >= size) return;
+    if(uniform || subblock)
+      sent=received=exchangeBytes(false);
+    if(!uniform) {
+      int start=schedule && a > 1 ? a*b : 0;
+      double S=sizeof(T)*L;
+      for(int P=0; P < size; ++P) {
+        if(P != rank && (rank >= start || P >= start)) {
+          double rows=S*m*ni(P);
+          double cols=S*n*mi(P);
+          sent += in ? rows : cols;
+          received += in ? cols : rows;
+        }
+      }
+    }
+  }
+  
 // inphase: N x m -> n x M
   void inphase0() {
+    double sent=0.0,received=0.0;
+    if(tracing) bytes0(true,sent,received);
+    traceScope trace("inphase0","transpose",sent,received);
     if(rank >= size) return;
     if(size == 1) {
       if(input != output)
@@ -634,9 +1093,26 @@ public:
       return;
     }
     if(compact) work=output;
+    if(datatype) {
+      // Receive each block directly into its final strided location.
+      T *send=input;
+      if(input == output) {
+        copy(input,work,N*m*L,threads);
+        send=work;
+      }
+      MPI_Ialltoall(send,n*m*sizeof(T)*L,MPI_BYTE,output,1,blocktype,
+                    communicator,Request);
+      return;
+    }
+    if(packed) {
+      pack((double *) input,sendf(),N*m*L*(sizeof(T)/sizeof(double)),
+           threads);
+      Ialltoall(sendf(),n*m*sizeof(T)*L/2,recvf(),split2,Request,sched2,
+                threads,cache(),inSplit2);
+      return;
+    }
     if(uniform || subblock)
-      Ialltoall(input,n*m*sizeof(T)*(a > 1 ? b : a)*L,work,split2,Request,
-                sched2,threads);
+      exchange(input,work,false,inSplit2);
     if(!uniform) {
       if(schedule) Ialltoallin(input,work,a > 1 ? a*b : 0,threads);
       else {
@@ -648,9 +1124,10 @@ public:
   }
   
   void insync0() {
+    traceScope trace("insync0");
     if(size == 1 || rank >= size) return;
     if(uniform || subblock)
-      Wait(2*(split2size-1),Request,schedule);
+      complete(false);
     if(!uniform) {
       if(schedule)
         Wait(2*Size(a > 1 ? a*b : 0),request,schedule);
@@ -660,23 +1137,39 @@ public:
   }
   
   void inphase1() {
+    double bytes=tracing && subblock ? exchangeBytes(true) : 0.0;
+    traceScope trace("inphase1","transpose",bytes,bytes);
     if(rank >= size) return;
     if(subblock) {
-      Tin2->transpose(work,output); // a x n*b x m*L
-      Ialltoall(output,n*m*sizeof(T)*a*L,work,split,Request,sched1,threads);
+      localtranspose(Tin2,work,output); // a x n*b x m*L
+      exchange(output,work,true,inSplit);
     }
   }
 
   void insync1() {
+    traceScope trace("insync1");
     if(rank >= size) return;
     if(subblock)
-      Wait(2*(splitsize-1),Request,schedule);
+      complete(true);
   }
 
   void inpost() {
-    if(size == 1 || rank >= size) return;
+    traceScope trace("inpost");
+    if(size == 1 || rank >= size || datatype) return;
+    if(packed) {
+      // Unpack while transposing b x n x m*L blocks to n x b x m*L.
+      unsigned int block=m*L*(sizeof(T)/sizeof(double));
+      float *recv=recvf();
+      double *out=(double *) output;
+      PARALLEL(
+        for(unsigned int i=0; i < n; ++i) {
+          for(int P=0; P < b; ++P)
+            unpack(recv+(P*n+i)*block,out+(i*b+P)*block,block);
+        });
+      return;
+    }
     if(uniform)
-      Tin1->transpose(work,output); // b x n*a x m*L
+      localtranspose(Tin1,work,output); // b x n*a x m*L
     else {
       if(subblock) {
         unsigned int block=m0*L;
@@ -696,38 +1189,43 @@ public:
         if(extra > 0) {
           unsigned int lastblock=mp*L;
           istride=n*block;
-          ostride=mlast*block+lastblock;
+          ostride=M*L;
 
           int ab=a*b;
           T *src=work+ab*istride;
           T *dest=output+ab*block;
-          int count=mlast-ab;
+          int count=mfull-ab;
           if(count > 0) {
             PARALLEL(
               for(unsigned int j=0; j < n; ++j)
                 copytoblock(src+j*block,dest+j*ostride,count,block,istride);
               );
           }
-          T *src2=work+mlast*istride;
-          T *dest2=output+mlast*block;
+          T *src2=work+mfull*istride;
+          T *dest2=output+mfull*block;
+          unsigned int count2=mlast+1-mfull;
           PARALLEL(
             for(unsigned int j=0; j < n; ++j)
-              copy(src2+j*lastblock,dest2+j*ostride,lastblock);
+              copytoblock(src2+j*lastblock,dest2+j*ostride,count2,lastblock,
+                          n*lastblock);
             );
         }
       } else {
+        // Columns of the first mfull processes are m0 wide; the rest are mp.
         unsigned int lastblock=mp*L;
         unsigned int block=m0*L;
         unsigned int istride=n*block;
-        unsigned int mlastblock=mlast*block;
-        unsigned int ostride=mlastblock+lastblock;
-        T *work2=work+mlast*istride;
+        unsigned int mfullblock=mfull*block;
+        unsigned int ostride=M*L;
+        unsigned int count=mlast+1-mfull;
+        T *work2=work+mfull*istride;
 
         PARALLEL(
           for(unsigned int j=0; j < n; ++j) {
             T *dest=output+j*ostride;
-            copytoblock(work+j*block,dest,mlast,block,istride);
-            copy(work2+j*lastblock,dest+mlastblock,lastblock);
+            copytoblock(work+j*block,dest,mfull,block,istride);
+            copytoblock(work2+j*lastblock,dest+mfullblock,count,lastblock,
+                        n*lastblock);
           });
       }
     }
@@ -735,6 +1233,11 @@ public:
   
 // outphase: n x M -> N x m
   void outphase0() {
+    double bytes=0.0;
+    if(tracing && size > 1 && rank < size)
+      bytes=subblock ? exchangeBytes(true) :
+        (datatype || packed ? exchangeBytes(false) : 0.0);
+    traceScope trace("outphase0","transpose",bytes,bytes);
     if(rank >= size) return;
     if(size == 1) {
       if(input != output)
@@ -742,9 +1245,29 @@ public:
       return;
     }
     if(compact) work=output;
+    if(datatype) {
+      // Send each strided block directly from the input.
+      MPI_Ialltoall(input,1,blocktype,input == output ? work : output,
+                    n*m*sizeof(T)*L,MPI_BYTE,communicator,Request);
+      return;
+    }
+    if(packed) {
+      // Pack while transposing n x b x m*L blocks to b x n x m*L.
+      unsigned int block=m*L*(sizeof(T)/sizeof(double));
+      float *send=sendf();
+      double *in=(double *) input;
+      PARALLEL(
+        for(unsigned int i=0; i < n; ++i) {
+          for(int P=0; P < b; ++P)
+            pack(in+(i*b+P)*block,send+(P*n+i)*block,block);
+        });
+      Ialltoall(send,n*m*sizeof(T)*L/2,recvf(),split2,Request,sched2,
+                threads,cache(),outSplit2);
+      return;
+    }
     // Inner transpose a N/a x M/a matrices over each team of b processes
     if(uniform)
-      Tout1->transpose(input,work); // n*a x b x m*L
+      localtranspose(Tout1,input,work); // n*a x b x m*L
     else {
       if(subblock) {
         unsigned int block=m0*L;
@@ -764,9 +1287,9 @@ public:
         if(extra > 0) {
           unsigned int lastblock=mp*L;
           istride=n*block;
-          ostride=mlast*block+lastblock;
+          ostride=M*L;
           int ab=a*b;
-          int count=mlast-ab;
+          int count=mfull-ab;
           T *src=input+ab*block;
           T *dest=work+ab*istride;
 
@@ -777,46 +1300,54 @@ public:
               );
           }
           
-          T *src2=input+mlast*block;
-          T *dest2=work+mlast*istride;
+          T *src2=input+mfull*block;
+          T *dest2=work+mfull*istride;
+          unsigned int count2=mlast+1-mfull;
           PARALLEL(
             for(unsigned int j=0; j < n; ++j)
-              copy(src2+j*ostride,dest2+j*lastblock,lastblock);
+              copyfromblock(src2+j*ostride,dest2+j*lastblock,count2,lastblock,
+                            n*lastblock);
             );
         }
       } else {
         unsigned int lastblock=mp*L;
         unsigned int block=m0*L;
         unsigned int istride=n*block;
-        unsigned int ostride=mlast*block+lastblock;
-        unsigned int mlastblock=mlast*block;
-        T *dest=work+mlast*istride;
+        unsigned int ostride=M*L;
+        unsigned int mfullblock=mfull*block;
+        unsigned int count=mlast+1-mfull;
+        T *dest=work+mfull*istride;
 
         PARALLEL(
           for(unsigned int j=0; j < n; ++j) {
             T *src=input+j*ostride;
-            copyfromblock(src,work+j*block,mlast,block,istride);
-            copy(src+mlastblock,dest+j*lastblock,lastblock);
+            copyfromblock(src,work+j*block,mfull,block,istride);
+            copyfromblock(src+mfullblock,dest+j*lastblock,count,lastblock,
+                          n*lastblock);
           });
       }
     }
     if(subblock)
-      Ialltoall(work,n*m*sizeof(T)*a*L,output,split,Request,sched1,threads);
+      exchange(work,output,true,outSplit);
     else outphase();
   }             
   
   void outsync0() {
+    traceScope trace("outsync0");
     if(rank >= size) return;
     if(subblock)
-      Wait(2*(splitsize-1),Request,schedule);
+      complete(true);
     else outsync();
   }
   
   void outphase() {
+    double sent=0.0,received=0.0;
+    if(tracing) bytes0(false,sent,received);
+    traceScope trace("outphase","transpose",sent,received);
     if(size == 1 || rank >= size) return;
     // Outer transpose a x a matrix of N/a x M/a blocks over a processes
     if(subblock)
-      Tout2->transpose(output,work); // n*b x a x m*L
+      localtranspose(Tout2,output,work); // n*b x a x m*L
     if(!uniform) {
       if(schedule) Ialltoallout(work,output,a > 1 ? a*b : 0,threads);
       else {
@@ -827,8 +1358,7 @@ public:
       }
     }
     if(uniform || subblock)
-      Ialltoall(work,n*m*sizeof(T)*(a > 1 ? b : a)*L,output,split2,Request,
-                sched2,threads);
+      exchange(work,output,false,outSplit2);
   }
   
   void outphase1() {
@@ -836,6 +1366,7 @@ public:
   }
   
   void outsync() {
+    traceScope trace("outsync");
     if(size == 1 || rank >= size) return;
     if(!uniform) {
       if(schedule)
@@ -844,7 +1375,12 @@ public:
         Wait(2*Size(last)+(rank < last ? 1 : 0),request,true);
     }
     if(uniform || subblock)
-      Wait(2*(split2size-1),Request,schedule);
+      complete(false);
+    if(datatype && input == output)
+      copy(work,output,N*m*L,threads);
+    if(packed)
+      unpack(recvf(),(double *) output,N*m*L*(sizeof(T)/sizeof(double)),
+             threads);
   }
   
   void outsync1() {
@@ -870,18 +1406,50 @@ public:
     }
   }
   
+  // Let the progress thread advance the exchanges in flight.
+  void poll() {
+    if(progress && size > 1 && !polling)
+      polling=progressBegin();
+  }
+  
+  void unpoll() {
+    if(polling) {
+      progressEnd();
+      polling=false;
+    }
+  }
+  
   void wait0() {
-    if(overlap) Wait0();
+    if(overlap) {
+      traceScope trace("wait0");
+      double start=utils::totalseconds();
+      unpoll();
+      Wait0();
+      poll();
+      waitseconds += utils::totalseconds()-start;
+    }
   }
   
   void wait1() {
-    if(overlap) Wait1();
+    if(overlap) {
+      traceScope trace("wait1");
+      double start=utils::totalseconds();
+      unpoll();
+      Wait1();
+      waitseconds += utils::totalseconds()-start;
+      ++waitcount;
+    }
   }
   
   void wait() {
     if(overlap) {
+      traceScope trace("wait");
+      double start=utils::totalseconds();
+      unpoll();
       Wait0();
       Wait1();
+      waitseconds += utils::totalseconds()-start;
+      ++waitcount;
     }
   }
   
@@ -904,7 +1472,8 @@ public:
     output=out;
     outphase0();
     outflag=true;
-    if(!overlap) {
+    if(overlap) poll();
+    else {
       Wait0();
       Wait1();
     }
@@ -916,7 +1485,8 @@ public:
     output=out;
     inphase0();
     outflag=false;
-    if(!overlap) {
+    if(overlap) poll();
+    else {
       Wait0();
       Wait1();
     }
@@ -924,6 +1494,346 @@ public:
   
 };
 
+// Globally transpose up to K fields of N x M blocks of L words together,
+// with a single exchange per process pair. Each message holds the rows of
+// every field: the side with complete rows is addressed in place through a
+// derived datatype, while the other side is packed into (unpacked from) a
+// work array of K*max(n*M,N*m)*L words in the pass that reorders columns.
+template<class T>
+class batchtranspose {
+  unsigned int N,M,n,m,L;
+  unsigned int K;
+  unsigned int threads;
+  unsigned int allocated;
+  T *work;
+  T **output;
+  unsigned int fields; // Number of fields in the current transpose
+  MPI_Comm communicator;
+  int size;
+  std::vector<int> rows,rowstart; // Rows of each process
+  std::vector<int> cols,colstart; // Columns of each process
+  std::vector<int> counts,displs,Counts,Displs;
+  std::vector<MPI_Datatype> types,Types;
+  MPI_Datatype rowtype;
+  MPI_Request request;
+  bool polling;
+
+  // Return a datatype addressing one row of each of the fields in f,
+  // which are the local n x m blocks, with an extent of one row.
+  MPI_Datatype rowType(T **f, unsigned int m) {
+    int S=m*L*sizeof(T);
+    std::vector<int> length(fields,S);
+    std::vector<MPI_Aint> address(fields);
+    for(unsigned int k=0; k < fields; ++k)
+      MPI_Get_address(f[k],&address[k]);
+    MPI_Datatype type,row;
+    MPI_Type_create_hindexed(fields,&length[0],&address[0],MPI_BYTE,&type);
+    MPI_Type_create_resized(type,0,S,&row);
+    MPI_Type_free(&type);
+    MPI_Type_commit(&row);
+    return row;
+  }
+
+  // Byte counts and displacements of the blocks of each process in the
+  // work array, which holds the n rows of every field for each block of
+  // columns in turn.
+  void workBlocks() {
+    int S=sizeof(T)*L*fields*n;
+    for(int P=0; P < size; ++P) {
+      Counts[P]=S*cols[P];
+      Displs[P]=S*colstart[P];
+    }
+  }
+
+  // Displacements of the rows of each process in the fields.
+  void rowBlocks(unsigned int m) {
+    int S=sizeof(T)*L*m;
+    for(int P=0; P < size; ++P) {
+      counts[P]=rows[P];
+      displs[P]=S*rowstart[P];
+    }
+  }
+
+  void exchange(void *sendbuf, std::vector<int>& sendcounts,
+                std::vector<int>& sdispls, std::vector<MPI_Datatype>& sendtypes,
+                void *recvbuf, std::vector<int>& recvcounts,
+                std::vector<int>& rdispls,
+                std::vector<MPI_Datatype>& recvtypes) {
+    traceScope trace("batchexchange");
+    MPI_Ialltoallw(sendbuf,&sendcounts[0],&sdispls[0],&sendtypes[0],
+                   recvbuf,&recvcounts[0],&rdispls[0],&recvtypes[0],
+                   communicator,&request);
+    if(overlap) {
+      if(progress && size > 1)
+        polling=progressBegin();
+    } else wait();
+  }
+
+public:
+  // in and out are arrays of up to K field pointers.
+  batchtranspose(unsigned int N, unsigned int M, unsigned int n,
+                 unsigned int m, unsigned int L, unsigned int K,
+                 MPI_Comm communicator=MPI_COMM_WORLD,
+                 const mpiOptions& options=defaultmpiOptions) :
+    N(N), M(M), n(n), m(m), L(L), K(K), threads(options.threads),
+    output(NULL), fields(0), communicator(communicator), polling(false) {
+    MPI_Comm_size(communicator,&size);
+    rows.resize(size);
+    cols.resize(size);
+    int local[]={(int) n,(int) m};
+    std::vector<int> all(2*size);
+    MPI_Allgather(local,2,MPI_INT,&all[0],2,MPI_INT,communicator);
+    rowstart.resize(size);
+    colstart.resize(size);
+    int row=0,col=0;
+    for(int P=0; P < size; ++P) {
+      rows[P]=all[2*P];
+      cols[P]=all[2*P+1];
+      rowstart[P]=row;
+      colstart[P]=col;
+      row += rows[P];
+      col += cols[P];
+    }
+    counts.resize(size);
+    displs.resize(size);
+    Counts.resize(size);
+    Displs.resize(size);
+    types.resize(size);
+    Types.assign(size,MPI_BYTE);
+    allocated=K*std::max(n*M,N*m)*L;
+    Array::newAlign(work,allocated,sizeof(T));
+  }
+
+  ~batchtranspose() {
+    Array::deleteAlign(work,allocated);
+  }
+
+  // Transpose the n x M blocks of the first count (default K) fields in to
+  // the N x m blocks of out.
+  void ilocalize0(T **in, T **out=NULL, unsigned int count=0) {
+    fields=count ? count : K;
+    output=NULL;
+    if(!out) out=in;
+    {
+      traceScope trace("batchpack");
+      unsigned int f=fields;
+      for(int P=0; P < size; ++P) {
+        unsigned int c=cols[P]*L;
+        T *dest=work+f*n*colstart[P]*L;
+        PARALLEL(
+          for(unsigned int i=0; i < n; ++i) {
+            for(unsigned int k=0; k < f; ++k)
+              copy(in[k]+(i*M+colstart[P])*L,dest+(i*f+k)*c,c);
+          });
+      }
+    }
+    workBlocks();
+    rowBlocks(m);
+    rowtype=rowType(out,m);
+    types.assign(size,rowtype);
+    exchange(work,Counts,Displs,Types,MPI_BOTTOM,counts,displs,types);
+  }
+
+  // Transpose the N x m blocks of the first count (default K) fields in to
+  // the n x M blocks of out.
+  void ilocalize1(T **in, T **out=NULL, unsigned int count=0) {
+    fields=count ? count : K;
+    output=out ? out : in;
+    workBlocks();
+    rowBlocks(m);
+    rowtype=rowType(in,m);
+    types.assign(size,rowtype);
+    exchange(MPI_BOTTOM,counts,displs,types,work,Counts,Displs,Types);
+  }
+
+  void wait() {
+    if(fields == 0) return;
+    {
+      traceScope trace("wait");
+      if(polling) {
+        progressEnd();
+        polling=false;
+      }
+      Wait(&request);
+      MPI_Type_free(&rowtype);
+    }
+    if(output) {
+      traceScope trace("batchunpack");
+      unsigned int f=fields;
+      T **out=output;
+      for(int P=0; P < size; ++P) {
+        unsigned int c=cols[P]*L;
+        T *src=work+f*n*colstart[P]*L;
+        PARALLEL(
+          for(unsigned int i=0; i < n; ++i) {
+            for(unsigned int k=0; k < f; ++k)
+              copy(src+(i*f+k)*c,out[k]+(i*M+colstart[P])*L,c);
+          });
+      }
+      output=NULL;
+    }
+    fields=0;
+  }
+
+  void localize0(T **in, T **out=NULL, unsigned int count=0) {
+    ilocalize0(in,out,count);
+    wait();
+  }
+
+  void localize1(T **in, T **out=NULL, unsigned int count=0) {
+    ilocalize1(in,out,count);
+    wait();
+  }
+};
+
+// Transpose chunk c of several fields between their N x m blocks and
+// separate chunk buffers of size n/C x M. Chunk c consists of the local
+// rows [c*n/C,(c+1)*n/C) of every process, so the rows keep their global
+// order. Both sides are addressed with derived datatypes; no work array
+// is needed. Every process must hold a multiple of C rows.
+template<class T>
+class chunktranspose {
+  unsigned int M,m,L;
+  unsigned int fields; // Number of fields in the current transpose
+  MPI_Comm communicator;
+  int size,rank;
+  std::vector<int> rows,rowstart; // Chunk rows and first row of each process
+  std::vector<int> cols,colstart; // Columns of each process
+  std::vector<int> rowcounts,colcounts,displs;
+  std::vector<MPI_Datatype> rowtypes,coltypes;
+  std::vector<MPI_Datatype> colblock; // Columns of P in one chunk buffer
+  MPI_Request request;
+  bool polling;
+
+  // Datatypes addressing the rows of chunk c of process P in each of the
+  // N x m blocks f.
+  void rowTypes(T **f, unsigned int c) {
+    std::vector<int> length(fields);
+    std::vector<MPI_Aint> address(fields);
+    for(int P=0; P < size; ++P) {
+      rowcounts[P]=rows[P]*m > 0;
+      rowtypes[P]=MPI_BYTE;
+      if(!rowcounts[P]) continue;
+      for(unsigned int k=0; k < fields; ++k) {
+        length[k]=rows[P]*m*L*sizeof(T);
+        MPI_Get_address(f[k]+(rowstart[P]+c*rows[P])*m*L,&address[k]);
+      }
+      MPI_Type_create_hindexed(fields,&length[0],&address[0],MPI_BYTE,
+                               &rowtypes[P]);
+      MPI_Type_commit(&rowtypes[P]);
+    }
+  }
+
+  // Datatypes addressing the columns of process P in each of the
+  // n/C x M chunk buffers f.
+  void colTypes(T **f) {
+    std::vector<int> length(fields,1);
+    std::vector<MPI_Aint> address(fields);
+    for(int P=0; P < size; ++P) {
+      colcounts[P]=rows[rank]*cols[P] > 0;
+      coltypes[P]=MPI_BYTE;
+      if(!colcounts[P]) continue;
+      for(unsigned int k=0; k < fields; ++k)
+        MPI_Get_address(f[k]+colstart[P]*L,&address[k]);
+      MPI_Type_create_hindexed(fields,&length[0],&address[0],colblock[P],
+                               &coltypes[P]);
+      MPI_Type_commit(&coltypes[P]);
+    }
+  }
+
+  void freeTypes(std::vector<int>& counts, std::vector<MPI_Datatype>& types) {
+    for(int P=0; P < size; ++P)
+      if(counts[P]) MPI_Type_free(&types[P]);
+  }
+
+  void exchange(std::vector<int>& sendcounts,
+                std::vector<MPI_Datatype>& sendtypes,
+                std::vector<int>& recvcounts,
+                std::vector<MPI_Datatype>& recvtypes) {
+    traceScope trace("chunkexchange");
+    MPI_Ialltoallw(MPI_BOTTOM,&sendcounts[0],&displs[0],&sendtypes[0],
+                   MPI_BOTTOM,&recvcounts[0],&displs[0],&recvtypes[0],
+                   communicator,&request);
+    if(overlap) {
+      if(progress && size > 1)
+        polling=progressBegin();
+    } else wait();
+  }
+
+public:
+  chunktranspose(unsigned int n, unsigned int M, unsigned int m,
+                 unsigned int L, unsigned int C,
+                 MPI_Comm communicator=MPI_COMM_WORLD) :
+    M(M), m(m), L(L), fields(0), communicator(communicator),
+    polling(false) {
+    MPI_Comm_size(communicator,&size);
+    MPI_Comm_rank(communicator,&rank);
+    int local[]={(int) n,(int) m};
+    std::vector<int> all(2*size);
+    MPI_Allgather(local,2,MPI_INT,&all[0],2,MPI_INT,communicator);
+    rows.resize(size);
+    rowstart.resize(size);
+    cols.resize(size);
+    colstart.resize(size);
+    int row=0,col=0;
+    for(int P=0; P < size; ++P) {
+      rows[P]=all[2*P]/C;
+      cols[P]=all[2*P+1];
+      rowstart[P]=row;
+      colstart[P]=col;
+      row += all[2*P];
+      col += cols[P];
+    }
+    rowcounts.resize(size);
+    colcounts.resize(size);
+    displs.assign(size,0);
+    rowtypes.resize(size);
+    coltypes.resize(size);
+    colblock.resize(size);
+    int S=sizeof(T)*L;
+    for(int P=0; P < size; ++P) {
+      MPI_Type_create_hvector(rows[rank],S*cols[P],S*M,MPI_BYTE,&colblock[P]);
+      MPI_Type_commit(&colblock[P]);
+    }
+  }
+
+  ~chunktranspose() {
+    for(int P=0; P < size; ++P)
+      MPI_Type_free(&colblock[P]);
+  }
+
+  // Transpose chunk c of the N x m blocks of the count fields in to the
+  // n/C x M chunk buffers out.
+  void ilocalize1(T **in, T **out, unsigned int count, unsigned int c) {
+    fields=count;
+    rowTypes(in,c);
+    colTypes(out);
+    exchange(rowcounts,rowtypes,colcounts,coltypes);
+  }
+
+  // Transpose the n/C x M chunk buffers of the count fields in back to
+  // chunk c of the N x m blocks out.
+  void ilocalize0(T **in, T **out, unsigned int count, unsigned int c) {
+    fields=count;
+    colTypes(in);
+    rowTypes(out,c);
+    exchange(colcounts,coltypes,rowcounts,rowtypes);
+  }
+
+  void wait() {
+    if(fields == 0) return;
+    traceScope trace("wait");
+    if(polling) {
+      progressEnd();
+      polling=false;
+    }
+    Wait(&request);
+    freeTypes(rowcounts,rowtypes);
+    freeTypes(colcounts,coltypes);
+    fields=0;
+  }
+};
+
 }
 
 #endif
@@ -5,55 +5,165 @@
 
 namespace utils {
 
-// Gather an MPI-distributed array onto the rank 0 process.
-// The distributed array has dimensions x*Y*Z.
-// The gathered array has dimensions    X*Y*Z.
+// Return a committed MPI datatype for ftype.
 template<class ftype>
-void gatherx(const ftype *part, ftype *whole, const split d,
-             const unsigned int Z, const MPI_Comm& communicator)
+MPI_Datatype elementtype()
+{
+  MPI_Datatype etype;
+  MPI_Type_contiguous(sizeof(ftype),MPI_BYTE,&etype);
+  MPI_Type_commit(&etype);
+  return etype;
+}
+
+// Return a committed copy of type with the extent of extent copies of etype.
+inline MPI_Datatype resized(MPI_Datatype type, MPI_Datatype etype,
+                            unsigned int extent)
+{
+  MPI_Aint lb,size;
+  MPI_Type_get_extent(etype,&lb,&size);
+  MPI_Datatype Type;
+  MPI_Type_create_resized(type,0,extent*size,&Type);
+  MPI_Type_commit(&Type);
+  MPI_Type_free(&type);
+  return Type;
+}
+
+// Collect the count and offset of each process on the rank 0 process.
+inline void blockcounts(unsigned int count, unsigned int offset,
+                        std::vector<int>& counts, std::vector<int>& displs,
+                        const MPI_Comm& communicator)
 {
-  int size, rank;
+  int size;
   MPI_Comm_size(communicator,&size);
-  MPI_Comm_rank(communicator,&rank);
+  counts.resize(size);
+  displs.resize(size);
+  std::vector<unsigned int> dims(2*size);
+  unsigned int parm[]={count,offset};
+  MPI_Gather(parm,2,MPI_UNSIGNED,&dims[0],2,MPI_UNSIGNED,0,communicator);
+  for(int p=0; p < size; ++p) {
+    counts[p]=dims[2*p];
+    displs[p]=dims[2*p+1];
+  }
+}
+
+// Gather (scatter) rows of length Y*Z, where rank p holds rows x0..x0+x-1.
+template<class ftype>
+void gathervx(ftype *part, ftype *whole, const split& d, unsigned int Z,
+              const MPI_Comm& communicator, bool scatter)
+{
+  MPI_Datatype etype=elementtype<ftype>();
+  MPI_Datatype row;
+  MPI_Type_contiguous(d.Y*Z,etype,&row);
+  MPI_Type_commit(&row);
+  std::vector<int> counts,displs;
+  blockcounts(d.x,d.x0,counts,displs,communicator);
+  if(scatter)
+    MPI_Scatterv(whole,&counts[0],&displs[0],row,part,d.x,row,0,
+                 communicator);
+  else
+    MPI_Gatherv(part,d.x,row,whole,&counts[0],&displs[0],row,0,
+                communicator);
+  MPI_Type_free(&row);
+  MPI_Type_free(&etype);
+}
+
+// Gather (scatter) columns of X blocks of Z values, where rank p holds
+// columns y0..y0+y-1. Each column is described in place by a strided
+// type, so the data lands directly in its final position.
+template<class ftype>
+void gathervy(ftype *part, ftype *whole, const split& d, unsigned int Z,
+              const MPI_Comm& communicator, bool scatter)
+{
+  MPI_Datatype etype=elementtype<ftype>();
+  MPI_Datatype type;
+  MPI_Type_vector(d.X,Z,d.y*Z,etype,&type);
+  MPI_Datatype local=resized(type,etype,Z);
+  MPI_Type_vector(d.X,Z,d.Y*Z,etype,&type);
+  MPI_Datatype global=resized(type,etype,Z);
+  std::vector<int> counts,displs;
+  blockcounts(d.y,d.y0,counts,displs,communicator);
+  if(scatter)
+    MPI_Scatterv(whole,&counts[0],&displs[0],global,part,d.y,local,0,
+                 communicator);
+  else
+    MPI_Gatherv(part,d.y,local,whole,&counts[0],&displs[0],global,0,
+                communicator);
+  MPI_Type_free(&global);
+  MPI_Type_free(&local);
+  MPI_Type_free(&etype);
+}
 
-  const unsigned int Y=d.Y;
-  const unsigned int x=d.x;
-  const unsigned int x0=d.x0;
+// Gather (scatter) the contiguous local blocks of dimensions local,
+// starting at start, of an array of dimensions global. The rank 0
+// process describes the block of each process by a subarray type, so the
+// data lands directly in its final position. The array whole is only
+// referenced on the rank 0 process.
+template<class ftype>
+void gathervblock(ftype *part, ftype *whole, const unsigned int *global,
+                  const unsigned int *local, const unsigned int *start,
+                  const MPI_Comm& communicator, bool scatter)
+{
+  int size,rank;
+  MPI_Comm_size(communicator,&size);
+  MPI_Comm_rank(communicator,&rank);
+  MPI_Datatype etype=elementtype<ftype>();
+  
+  std::vector<unsigned int> dims(6*size);
+  unsigned int parm[]={local[0],local[1],local[2],start[0],start[1],start[2]};
+  MPI_Gather(parm,6,MPI_UNSIGNED,&dims[0],6,MPI_UNSIGNED,0,communicator);
   
+  // Only the rank 0 process exchanges nonempty messages.
+  std::vector<int> lcounts(size,0),gcounts(size,0),displs(size,0);
+  std::vector<MPI_Datatype> ltypes(size,etype),gtypes(size,etype);
+  lcounts[0]=local[0]*local[1]*local[2];
+  if(rank != 0) whole=NULL;
   if(rank == 0) {
-    // First copy rank 0's part into the whole
-    int offset=x0*Y*Z;
-    int count=x;
-    int length=Y*Z;
-    int stride=Y*Z;
-    copyfromblock(part,whole+offset,count,length,stride);
-      
-    for(int p=1; p < size; ++p) {
-      unsigned int dims[2];
-      MPI_Recv(&dims,2,MPI_UNSIGNED,p,0,communicator,MPI_STATUS_IGNORE);
-
-      unsigned int x=dims[0];
-      unsigned int x0=dims[1];
-      unsigned int n=Z*x*Y;
-      if(n > 0) {
-        ftype *C=new ftype[n];
-        MPI_Recv(C,sizeof(ftype)*n,MPI_BYTE,p,0,communicator,
-                 MPI_STATUS_IGNORE);
-        int offset=x0*Y*Z;
-        int count=x;
-        int length=Y*Z;
-        int stride=Y*Z;
-        copyfromblock(C,whole+offset,count,length,stride);
-        delete [] C;
+    int sizes[3],subsizes[3],starts[3];
+    for(unsigned int i=0; i < 3; ++i)
+      sizes[i]=global[i];
+    for(int p=0; p < size; ++p) {
+      unsigned int *q=&dims[6*p];
+      if(q[0]*q[1]*q[2] == 0) continue;
+      for(unsigned int i=0; i < 3; ++i) {
+        subsizes[i]=q[i];
+        starts[i]=q[3+i];
       }
+      MPI_Type_create_subarray(3,sizes,subsizes,starts,MPI_ORDER_C,etype,
+                               &gtypes[p]);
+      MPI_Type_commit(&gtypes[p]);
+      gcounts[p]=1;
     }
-  } else {
-    unsigned int dims[]={x,x0};
-    MPI_Send(&dims,2,MPI_UNSIGNED,0,0,communicator);
-    unsigned int n=Z*x*Y;
-    if(n > 0)
-      MPI_Send((ftype *) part,n*sizeof(ftype),MPI_BYTE,0,0,communicator);
   }
+  
+  if(scatter)
+    MPI_Alltoallw(whole,&gcounts[0],&displs[0],&gtypes[0],
+                  part,&lcounts[0],&displs[0],&ltypes[0],communicator);
+  else
+    MPI_Alltoallw(part,&lcounts[0],&displs[0],&ltypes[0],
+                  whole,&gcounts[0],&displs[0],&gtypes[0],communicator);
+  
+  for(int p=0; p < size; ++p)
+    if(gcounts[p]) MPI_Type_free(&gtypes[p]);
+  MPI_Type_free(&etype);
+}
+
+// Gather an MPI-distributed array onto the rank 0 process.
+// The distributed array has dimensions x*Y*Z.
+// The gathered array has dimensions    X*Y*Z.
+template<class ftype>
+void gatherx(const ftype *part, ftype *whole, const split d,
+             const unsigned int Z, const MPI_Comm& communicator)
+{
+  gathervx((ftype *) part,whole,d,Z,communicator,false);
+}
+
+// Scatter an array on the rank 0 process to an MPI-distributed array
+// (inverse of gatherx).
+template<class ftype>
+void scatterx(const ftype *whole, ftype *part, const split d,
+              const unsigned int Z, const MPI_Comm& communicator)
+{
+  gathervx(part,(ftype *) whole,d,Z,communicator,true);
 }
 
 // Gather an MPI-distributed array onto the rank 0 process.
@@ -63,48 +173,16 @@ template<class ftype>
 void gathery(const ftype *part, ftype *whole, const split d,
              const unsigned int Z, const MPI_Comm& communicator)
 {
-  int size, rank;
-  MPI_Comm_size(communicator,&size);
-  MPI_Comm_rank(communicator,&rank);
+  gathervy((ftype *) part,whole,d,Z,communicator,false);
+}
 
-  const unsigned int X=d.X;
-  const unsigned int Y=d.Y;
-  const unsigned int y=d.y;
-  const unsigned int y0=d.y0;
-  
-  if(rank == 0) {
-    // First copy rank 0's part into the whole
-    int offset=y0*Z;
-    int count=X;
-    int length=y*Z;
-    int stride=Y*Z;
-    copyfromblock(part,whole+offset,count,length,stride);
-      
-    for(int p=1; p < size; ++p) {
-      unsigned int dims[2];
-      MPI_Recv(&dims,2,MPI_UNSIGNED,p,0,communicator,MPI_STATUS_IGNORE);
-      unsigned int y=dims[0];
-      unsigned int y0=dims[1];
-      unsigned int n=Z*X*y;
-      if(n > 0) {
-        ftype *C=new ftype[n];
-        MPI_Recv(C,sizeof(ftype)*n,MPI_BYTE,p,0,communicator,
-                 MPI_STATUS_IGNORE);
-        int offset=y0*Z;
-        int count=X;
-        int length=y*Z;
-        int stride=Y*Z;
-        copyfromblock(C,whole+offset,count,length,stride);
-        delete [] C;
-      }
-    }
-  } else {
-    unsigned int dims[]={y,y0};
-    MPI_Send(&dims,2,MPI_UNSIGNED,0,0,communicator);
-    unsigned int n=Z*X*y;
-    if(n > 0)
-      MPI_Send((ftype *) part,n*sizeof(ftype),MPI_BYTE,0,0,communicator);
-  }
+// Scatter an array on the rank 0 process to an MPI-distributed array
+// (inverse of gathery).
+template<class ftype>
+void scattery(const ftype *whole, ftype *part, const split d,
+              const unsigned int Z, const MPI_Comm& communicator)
+{
+  gathervy(part,(ftype *) whole,d,Z,communicator,true);
 }
 
 // Gather an MPI-distributed array onto the rank 0 process.
@@ -114,60 +192,22 @@ template<class ftype>
 void gatheryz(const ftype *part, ftype *whole, const split3& d,
               const MPI_Comm& communicator)
 {
-  int size, rank;
-  MPI_Comm_size(communicator,&size);
-  MPI_Comm_rank(communicator,&rank);
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.X,d.xy.y,d.z};
+  unsigned int start[]={0,d.xy.y0,d.z0};
+  gathervblock((ftype *) part,whole,global,local,start,communicator,false);
+}
 
-  const unsigned int X=d.X;
-  const unsigned int Y=d.Y;
-  const unsigned int Z=d.Z;
-  const unsigned int y=d.xy.y;
-  const unsigned int z=d.z;
-  const unsigned int y0=d.xy.y0;
-  const unsigned int z0=d.z0;
-  
-  if(rank == 0) {
-    // First copy rank 0's part into the whole
-    const int count=y;
-    const int stride=Z;
-    const int length=z;
-    for(unsigned int i=0; i < X; ++i) {
-      const int outoffset=i*Y*Z+y0*Z+z0;
-      const int inoffset=i*y*z;
-      copyfromblock(part+inoffset,whole+outoffset,
-                    count,length,stride);
-    }
-    for(int p=1; p < size; ++p) {
-      unsigned int dims[4];
-      MPI_Recv(&dims,4,MPI_UNSIGNED,p,0,communicator,MPI_STATUS_IGNORE);
-      unsigned int y=dims[0];
-      unsigned int z=dims[1];
-      unsigned int y0=dims[2];
-      unsigned int z0=dims[3];
-
-      unsigned int n=X*y*z;
-      if(n > 0) {
-        ftype *C=new ftype[n];
-        MPI_Recv(C,sizeof(ftype)*n,MPI_BYTE,p,0,communicator,
-                 MPI_STATUS_IGNORE);
-        const int count=y;
-        const int stride=Z;
-        const int length=z;
-        for(unsigned int i=0; i < X; ++i) {
-          const int outoffset=i*Y*Z+y0*Z+z0;
-          const int inoffset=i*y*z;
-          copyfromblock(C+inoffset,whole+outoffset,count,length,stride);
-        }
-        delete [] C;
-      }
-    }
-  } else {
-    unsigned int dims[]={y,z,y0,z0};
-    MPI_Send(&dims,4,MPI_UNSIGNED,0,0,communicator);
-    unsigned int n=X*y*z;
-    if(n > 0)
-      MPI_Send((ftype *) part,n*sizeof(ftype),MPI_BYTE,0,0,communicator);
-  }
+// Scatter an array on the rank 0 process to an MPI-distributed array
+// (inverse of gatheryz).
+template<class ftype>
+void scatteryz(const ftype *whole, ftype *part, const split3& d,
+               const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.X,d.xy.y,d.z};
+  unsigned int start[]={0,d.xy.y0,d.z0};
+  gathervblock(part,(ftype *) whole,global,local,start,communicator,true);
 }
 
 // Gather an MPI-distributed array onto the rank 0 process.
@@ -179,67 +219,228 @@ void gatherxy(const ftype *part,
               const split3 d,
               const MPI_Comm& communicator)
 {
-  int size, rank;
-  MPI_Comm_size(communicator,&size);
-  MPI_Comm_rank(communicator,&rank);
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.x,d.yz.x,d.Z};
+  unsigned int start[]={d.x0,d.yz.x0,0};
+  gathervblock((ftype *) part,whole,global,local,start,communicator,false);
+}
+
+// Scatter an array on the rank 0 process to an MPI-distributed array
+// (inverse of gatherxy).
+template<class ftype>
+void scatterxy(const ftype *whole, ftype *part, const split3& d,
+               const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.x,d.yz.x,d.Z};
+  unsigned int start[]={d.x0,d.yz.x0,0};
+  gathervblock(part,(ftype *) whole,global,local,start,communicator,true);
+}
+
+// Collective checkpointing of distributed arrays with MPI-IO.
+//
+// The file consists of a header of mpiioheader bytes followed by the
+// global X*Y*Z array in row-major order:
+//   char magic[8]            "fftw++io"
+//   unsigned int version     1
+//   unsigned int size        sizeof(ftype)
+//   unsigned int X,Y,Z       global dimensions
+//   unsigned int reserved    0
+// All values are stored in native byte order. Each process writes and
+// reads its own block through a subarray file view, so no process ever
+// holds more than its local part.
+
+const char mpiiomagic[]="fftw++io";
+const unsigned int mpiioversion=1;
+const unsigned int mpiioheader=32;
+
+// Set the file view to the block local of global starting at start,
+// returning the element type.
+template<class ftype>
+void mpiioview(MPI_File fh, const unsigned int *global,
+               const unsigned int *local, const unsigned int *start,
+               MPI_Datatype& etype)
+{
+  etype=elementtype<ftype>();
+  // An empty block is given a nonempty view but transfers no elements.
+  bool empty=local[0]*local[1]*local[2] == 0;
+  int sizes[3],subsizes[3],starts[3];
+  for(unsigned int i=0; i < 3; ++i) {
+    sizes[i]=global[i];
+    subsizes[i]=empty ? 1 : local[i];
+    starts[i]=empty ? 0 : start[i];
+  }
+  MPI_Datatype filetype;
+  MPI_Type_create_subarray(3,sizes,subsizes,starts,MPI_ORDER_C,etype,
+                           &filetype);
+  MPI_Type_commit(&filetype);
+  MPI_File_set_view(fh,mpiioheader,etype,filetype,(char *) "native",
+                    MPI_INFO_NULL);
+  MPI_Type_free(&filetype);
+}
+
+inline void mpiioerror(const char *filename, const char *message)
+{
+  std::cerr << "Cannot " << message << " " << filename << std::endl;
+  exit(1);
+}
 
-  const unsigned int Y=d.Y;
-  const unsigned int Z=d.Z;
-  const unsigned int x=d.x;
-  const unsigned int y=d.yz.x;
-  const unsigned int x0=d.x0;
-  const unsigned int y0=d.yz.x0;
-                
+// Write the local block of dimensions local, starting at start, of a
+// distributed array of dimensions global.
+template<class ftype>
+void writeblock(const char *filename, const ftype *part,
+                const unsigned int *global, const unsigned int *local,
+                const unsigned int *start, const MPI_Comm& communicator)
+{
+  MPI_File fh;
+  if(MPI_File_open(communicator,(char *) filename,
+                   MPI_MODE_CREATE | MPI_MODE_WRONLY,MPI_INFO_NULL,&fh)
+     != MPI_SUCCESS)
+    mpiioerror(filename,"open");
+  MPI_File_set_size(fh,0);
+
+  int rank;
+  MPI_Comm_rank(communicator,&rank);
   if(rank == 0) {
-    // First copy rank 0's part into the whole
-    const int count=y;
-    const int stride=Z;
-    const int length=Z;
-    for(unsigned int i=0; i < x; ++i) {
-      const int poffset=i*y*Z;
-      const int woffset=(x0+i)*Y*Z+y0*Z;
-      copyfromblock(part+poffset,whole+woffset,
-                    count,length,stride);
-    }
-    for(int p=1; p < size; ++p) {
-      unsigned int dims[4];
-      MPI_Recv(&dims,4,MPI_UNSIGNED,p,0,communicator,MPI_STATUS_IGNORE);
-      unsigned int x=dims[0];
-      unsigned int y=dims[1];
-      unsigned int x0=dims[2];
-      unsigned int y0=dims[3];
-
-      unsigned int n=x*y*Z;
-      if(n > 0) {
-        ftype *C=new ftype[n];
-        MPI_Recv(C,sizeof(ftype)*n,MPI_BYTE,p,0,communicator,
-                 MPI_STATUS_IGNORE);
-        const int count=y;
-        const int stride=Z;
-        const int length=Z;
-        for(unsigned int i=0; i < x; ++i) {
-          const int poffset=i*y*Z;
-          const int woffset=(x0+i)*Y*Z+y0*Z;
-          copyfromblock(C+poffset,whole+woffset,
-                        count,length,stride);
-
-        }
-        delete [] C;
-      }
-    }
-  } else {
-    unsigned int dims[] = {x,y,x0,y0};
-    MPI_Send(&dims,4,MPI_UNSIGNED,0,0,communicator);
-    unsigned int n=x*y*Z;
-    if(n > 0)
-      MPI_Send((ftype *) part,n*sizeof(ftype),MPI_BYTE,0,0,communicator);
+    char header[mpiioheader];
+    unsigned int parm[]={mpiioversion,sizeof(ftype),global[0],global[1],
+                         global[2],0};
+    memcpy(header,mpiiomagic,8);
+    memcpy(header+8,parm,sizeof(parm));
+    MPI_File_write_at(fh,0,header,mpiioheader,MPI_BYTE,MPI_STATUS_IGNORE);
   }
+
+  MPI_Datatype etype;
+  mpiioview<ftype>(fh,global,local,start,etype);
+  MPI_File_write_all(fh,(ftype *) part,local[0]*local[1]*local[2],etype,
+                     MPI_STATUS_IGNORE);
+  MPI_Type_free(&etype);
+  MPI_File_close(&fh);
+}
+
+// Read the local block of dimensions local, starting at start, of a
+// distributed array of dimensions global, checking the header.
+template<class ftype>
+void readblock(const char *filename, ftype *part,
+               const unsigned int *global, const unsigned int *local,
+               const unsigned int *start, const MPI_Comm& communicator)
+{
+  MPI_File fh;
+  if(MPI_File_open(communicator,(char *) filename,MPI_MODE_RDONLY,
+                   MPI_INFO_NULL,&fh) != MPI_SUCCESS)
+    mpiioerror(filename,"open");
+
+  int rank;
+  MPI_Comm_rank(communicator,&rank);
+  char header[mpiioheader];
+  if(rank == 0)
+    MPI_File_read_at(fh,0,header,mpiioheader,MPI_BYTE,MPI_STATUS_IGNORE);
+  MPI_Bcast(header,mpiioheader,MPI_BYTE,0,communicator);
+  unsigned int parm[6];
+  memcpy(parm,header+8,sizeof(parm));
+  if(memcmp(header,mpiiomagic,8) != 0 || parm[0] != mpiioversion)
+    mpiioerror(filename,"recognize");
+  if(parm[1] != sizeof(ftype) || parm[2] != global[0] ||
+     parm[3] != global[1] || parm[4] != global[2])
+    mpiioerror(filename,"match the dimensions of");
+
+  MPI_Datatype etype;
+  mpiioview<ftype>(fh,global,local,start,etype);
+  MPI_File_read_all(fh,part,local[0]*local[1]*local[2],etype,
+                    MPI_STATUS_IGNORE);
+  MPI_Type_free(&etype);
+  MPI_File_close(&fh);
+}
+
+// Write (read) an MPI-distributed array of dimensions x*Y*Z (cf. gatherx).
+template<class ftype>
+void writex(const char *filename, const ftype *part, const split& d,
+            unsigned int Z, const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,Z};
+  unsigned int local[]={d.x,d.Y,Z};
+  unsigned int start[]={d.x0,0,0};
+  writeblock(filename,part,global,local,start,communicator);
+}
+
+template<class ftype>
+void readx(const char *filename, ftype *part, const split& d,
+           unsigned int Z, const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,Z};
+  unsigned int local[]={d.x,d.Y,Z};
+  unsigned int start[]={d.x0,0,0};
+  readblock(filename,part,global,local,start,communicator);
+}
+
+// Write (read) an MPI-distributed array of dimensions X*y*Z (cf. gathery).
+template<class ftype>
+void writey(const char *filename, const ftype *part, const split& d,
+            unsigned int Z, const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,Z};
+  unsigned int local[]={d.X,d.y,Z};
+  unsigned int start[]={0,d.y0,0};
+  writeblock(filename,part,global,local,start,communicator);
 }
 
+template<class ftype>
+void ready(const char *filename, ftype *part, const split& d,
+           unsigned int Z, const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,Z};
+  unsigned int local[]={d.X,d.y,Z};
+  unsigned int start[]={0,d.y0,0};
+  readblock(filename,part,global,local,start,communicator);
+}
+
+// Write (read) an MPI-distributed array of dimensions X*y*z
+// (cf. gatheryz).
+template<class ftype>
+void writeyz(const char *filename, const ftype *part, const split3& d,
+             const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.X,d.xy.y,d.z};
+  unsigned int start[]={0,d.xy.y0,d.z0};
+  writeblock(filename,part,global,local,start,communicator);
+}
+
+template<class ftype>
+void readyz(const char *filename, ftype *part, const split3& d,
+            const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.X,d.xy.y,d.z};
+  unsigned int start[]={0,d.xy.y0,d.z0};
+  readblock(filename,part,global,local,start,communicator);
+}
+
+// Write (read) an MPI-distributed array of dimensions x*y*Z
+// (cf. gatherxy).
+template<class ftype>
+void writexy(const char *filename, const ftype *part, const split3& d,
+             const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.x,d.yz.x,d.Z};
+  unsigned int start[]={d.x0,d.yz.x0,0};
+  writeblock(filename,part,global,local,start,communicator);
+}
+
+template<class ftype>
+void readxy(const char *filename, ftype *part, const split3& d,
+            const MPI_Comm& communicator)
+{
+  unsigned int global[]={d.X,d.Y,d.Z};
+  unsigned int local[]={d.x,d.yz.x,d.Z};
+  unsigned int start[]={d.x0,d.yz.x0,0};
+  readblock(filename,part,global,local,start,communicator);
+}
 
 template<class T>
 int checkerror(const T *f, const T *control, unsigned int n, unsigned int M,
-               unsigned int dist)
+               unsigned int dist, double tolerance=1e-12)
 {
   double maxerr=0.0;
   double norm=0.0;
@@ -255,7 +456,7 @@ int checkerror(const T *f, const T *control, unsigned int n, unsigned int M,
   }
 
   std::cout << "Maximum error: " << maxerr << std::endl;
-  if(maxerr <= 1e-12*norm) {
+  if(maxerr <= tolerance*norm) {
     std::cout << "Error ok." << std::endl;
     return 0;
   }
@@ -264,9 +465,10 @@ int checkerror(const T *f, const T *control, unsigned int n, unsigned int M,
 }
 
 template<class T>
-int checkerror(const T *f, const T *control, unsigned int stop)
+int checkerror(const T *f, const T *control, unsigned int stop,
+               double tolerance=1e-12)
 {
-  return checkerror(f, control, stop, 1, stop);
+  return checkerror(f, control, stop, 1, stop, tolerance);
 }
 
 template<class ftype>
@@ -47,6 +47,8 @@ int main(int argc, char* argv[])
   int retval=0;
   bool test=false;
   bool quiet=false;
+  bool single=false; // Communicate in single precision
+  bool batch=false; // Transpose the inputs together
   
   unsigned int A=2; // Number of independent inputs
   unsigned int B=1; // Number of outputs
@@ -54,7 +56,7 @@ int main(int argc, char* argv[])
   int stats=0;
   
   int provided;
-  MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
+  MPI_Init_thread(&argc,&argv,MPI_THREAD_MULTIPLE,&provided);
 
   int rank;
   MPI_Comm_rank(MPI_COMM_WORLD,&rank);
@@ -63,7 +65,7 @@ int main(int argc, char* argv[])
   optind=0;
 #endif  
   for (;;) {
-    int c = getopt(argc,argv,"hqta:A:B:N:m:s:x:y:n:T:S:i");
+    int c = getopt(argc,argv,"hqtfkPa:A:B:N:m:R:s:x:y:n:T:S:i");
     if (c == -1) break;
                 
     switch (c) {
@@ -78,6 +80,18 @@ int main(int argc, char* argv[])
       case 'B':
         B=atoi(optarg);
         break;
+      case 'f':
+        single=true;
+        break;
+      case 'k':
+        batch=true;
+        break;
+      case 'P':
+        progress=true;
+        break;
+      case 'R':
+        tracing=atoi(optarg);
+        break;
       case 'N':
         N=atoi(optarg);
         break;
@@ -116,6 +130,13 @@ int main(int argc, char* argv[])
         if(rank == 0) {
           usage(2);
           usageTranspose();
+          std::cerr << "-f\t\t single-precision communication "
+                    << "(divisible layouts only)" << std::endl;
+          std::cerr << "-k\t\t batch input and output transposes" << std::endl;
+          std::cerr << "-P\t\t progress thread (MPI_THREAD_MULTIPLE)"
+                    << std::endl;
+          std::cerr << "-R<int>\t\t trace to cconv2.<rank> "
+                    << "[0=off, 1=CSV, 2=Chrome trace]" << std::endl;
         }
         exit(1);
     }
@@ -178,8 +199,12 @@ int main(int argc, char* argv[])
 
     bool showresult = mx*my < outlimit;
     
-    ImplicitConvolution2MPI C(mx,my,d,mpiOptions(divisor,alltoall),A,B);
+    ImplicitConvolution2MPI C(mx,my,d,
+                              mpiOptions(divisor,alltoall,defaultmpithreads,0,
+                                         single,batch),A,B);
 
+    traceClear(); // Omit the tuning
+    
     if(test) {
       init(F,d,A);
 
@@ -222,7 +247,8 @@ int main(int argc, char* argv[])
           Array2<Complex> AFlocal0(mx,my,Flocal[0]);
           cout << AFlocal0 << endl;
         }
-        retval += checkerror(Flocal[0],Foutgather,d.X*d.Y);
+        retval += checkerror(Flocal[0],Foutgather,d.X*d.Y,
+                             single ? 1e-6 : 1e-12);
       }
 
       deleteAlign(Foutgather);
@@ -238,6 +264,8 @@ int main(int argc, char* argv[])
 
       MPI_Barrier(group.active);
       
+      double wait0=waitseconds;
+      unsigned int count0=waitcount;
       double *T=new double[N];
       for(unsigned int i=0; i < N; ++i) {
         init(F,d,A);
@@ -250,11 +278,34 @@ int main(int argc, char* argv[])
       if(main) 
         timings("Implicit",mx,T,N,stats);
       delete [] T;
+      
+      if(tracing) {
+        traceWrite("cconv2",group.active);
+        tracing=traceOff; // Omit the overlap measurement
+      }
+      
+      // Compare the time blocked per overlapped transpose to that of a
+      // blocking transpose.
+      if(!quiet && group.size > 1 && waitcount > count0) {
+        double wait=(waitseconds-wait0)/(waitcount-count0);
+        double Wait;
+        MPI_Allreduce(&wait,&Wait,1,MPI_DOUBLE,MPI_MAX,group.active);
+        mpitranspose<Complex> Tr(d.X,d.Y,d.x,d.y,1,F[0],NULL,group.active,
+                                 mpiOptions(divisor,alltoall,
+                                            defaultmpithreads,0,single));
+        double t=Tr.time(F[0]);
+        if(main)
+          cout << "Overlap fraction: " << max(1.0-Wait/t,0.0)
+               << (progress ? " (progress thread)" : "") << endl;
+      }
     }   
 
     if(!quiet && showresult)
       show(F[0],mx,d.y,group.active);
 
+    if(tracing)
+      traceWrite("cconv2",group.active);
+
     for(unsigned int a=0; a < A; ++a)
       deleteAlign(F[a]);
     delete [] F;
@@ -82,6 +82,7 @@ int main(int argc, char* argv[])
   int retval=0;
   bool test=false;
   bool quiet=false;
+  bool batch=false; // Transpose the inputs together
   
   int provided;
   MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
@@ -93,7 +94,7 @@ int main(int argc, char* argv[])
   optind=0;
 #endif  
   for (;;) {
-    int c = getopt(argc,argv,"ihtqa:A:B:N:T:S:m:n:s:x:y:z:");
+    int c = getopt(argc,argv,"ihtqka:c:A:B:N:T:S:m:n:s:x:y:z:");
     if (c == -1) break;
                 
     switch (c) {
@@ -105,6 +106,12 @@ int main(int argc, char* argv[])
       case 'B':
         B=atoi(optarg);
         break;
+      case 'k':
+        batch=true;
+        break;
+      case 'c':
+        pipelinechunks=atoi(optarg);
+        break;
       case 'a':
         divisor=atoi(optarg);
         break;
@@ -149,6 +156,9 @@ int main(int argc, char* argv[])
         if(rank == 0) {
           usage(3);
           usageTranspose();
+          std::cerr << "-k\t\t batch input and output transposes" << std::endl;
+          std::cerr << "-c<int>\t\t number of pipelined x chunks [0=tune]"
+                    << std::endl;
         }
         exit(1);
     }
@@ -217,7 +227,9 @@ int main(int argc, char* argv[])
       F[a]=ComplexAlign(d.n);
     }
 
-    ImplicitConvolution3MPI C(mx,my,mz,d,mpiOptions(divisor,alltoall),A,B);
+    ImplicitConvolution3MPI C(mx,my,mz,d,
+                              mpiOptions(divisor,alltoall,defaultmpithreads,0,
+                                         false,batch),A,B);
 
     if(test) {
       init(F,d,A);
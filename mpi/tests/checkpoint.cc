@@ -0,0 +1,167 @@
+#include "Array.h"
+#include "mpifftw++.h"
+#include "utils.h"
+
+using namespace std;
+using namespace utils;
+using namespace fftwpp;
+using namespace Array;
+
+inline Complex value(unsigned int i, unsigned int j, unsigned int k)
+{
+  return Complex(i,j+0.01*k);
+}
+
+// Check a block local of an array of dimensions global starting at start.
+int check(const Complex *f, const unsigned int *local,
+          const unsigned int *start)
+{
+  int errors=0;
+  for(unsigned int i=0; i < local[0]; ++i)
+    for(unsigned int j=0; j < local[1]; ++j)
+      for(unsigned int k=0; k < local[2]; ++k)
+        if(*(f++) != value(start[0]+i,start[1]+j,start[2]+k)) ++errors;
+  return errors;
+}
+
+void init(Complex *f, const unsigned int *local, const unsigned int *start)
+{
+  for(unsigned int i=0; i < local[0]; ++i)
+    for(unsigned int j=0; j < local[1]; ++j)
+      for(unsigned int k=0; k < local[2]; ++k)
+        *(f++)=value(start[0]+i,start[1]+j,start[2]+k);
+}
+
+int main(int argc, char* argv[])
+{
+  int retval=0; // success!
+  
+  bool quiet=false;
+  unsigned int mx=4;
+  unsigned int my=4;
+  unsigned int mz=4;
+  const char *filename="checkpoint.dat";
+  
+  int provided;
+  MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
+
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+  if(rank != 0) opterr=0;
+#ifdef __GNUC__ 
+  optind=0;
+#endif  
+  for (;;) {
+    int c=getopt(argc,argv,"hm:x:y:z:q");
+    if (c == -1) break;
+    
+    switch (c) {
+      case 0:
+        break;
+      case 'm':
+        mx=my=mz=atoi(optarg);
+        break;
+      case 'x':
+        mx=atoi(optarg);
+        break;
+      case 'y':
+        my=atoi(optarg);
+        break;
+      case 'z':
+        mz=atoi(optarg);
+        break;
+      case 'q':
+        quiet=true;
+        break;
+      case 'h':
+      default:
+        if(rank == 0)
+          usageGather();
+        exit(1);
+    }
+  }
+
+  if(my == 0) my=mx;
+  if(mz == 0) mz=mx;
+  
+  // 2D: write in x*Y*Z order and restart in X*y*Z order.
+  {
+    MPIgroup group(MPI_COMM_WORLD,mx);
+    if(group.rank < group.size) {
+      split d(mx,my,group.active);
+      Complex *f=ComplexAlign(d.n*mz);
+      
+      unsigned int local[]={d.x,d.Y,mz};
+      unsigned int start[]={d.x0,0,0};
+      init(f,local,start);
+      writex(filename,f,d,mz,group.active);
+      
+      for(unsigned int i=0; i < d.n*mz; ++i)
+        f[i]=0.0;
+      ready(filename,f,d,mz,group.active);
+      unsigned int locali[]={d.X,d.y,mz};
+      unsigned int starti[]={0,d.y0,0};
+      int errors=check(f,locali,starti);
+      
+      readx(filename,f,d,mz,group.active);
+      errors += check(f,local,start);
+      
+      int total;
+      MPI_Reduce(&errors,&total,1,MPI_INT,MPI_SUM,0,group.active);
+      if(group.rank == 0) {
+        if(!quiet) cout << "x*Y*Z -> X*y*Z: ";
+        if(total == 0) cout << "OK." << endl;
+        else {
+          cout << "ERROR!" << endl;
+          retval += 1;
+        }
+      }
+      deleteAlign(f);
+    }
+  }
+  
+  // 3D: write in x*y*Z order and restart in X*y*z order.
+  {
+    MPIgroup group(MPI_COMM_WORLD,mx,my);
+    if(group.rank < group.size) {
+      split3 d(mx,my,mz,group);
+      Complex *f=ComplexAlign(std::max(d.n,d.n2));
+      
+      unsigned int local[]={d.x,d.yz.x,d.Z};
+      unsigned int start[]={d.x0,d.yz.x0,0};
+      init(f,local,start);
+      writexy(filename,f,d,group.active);
+      
+      readyz(filename,f,d,group.active);
+      unsigned int localt[]={d.X,d.xy.y,d.z};
+      unsigned int startt[]={0,d.xy.y0,d.z0};
+      int errors=check(f,localt,startt);
+      
+      int total;
+      MPI_Reduce(&errors,&total,1,MPI_INT,MPI_SUM,0,group.active);
+      if(group.rank == 0) {
+        if(!quiet) cout << "x*y*Z -> X*y*z: ";
+        if(total == 0) cout << "OK." << endl;
+        else {
+          cout << "ERROR!" << endl;
+          retval += 1;
+        }
+      }
+      deleteAlign(f);
+    }
+  }
+
+  if(rank == 0) {
+    remove(filename);
+    cout << endl;
+    if(retval == 0) {
+      cout << "Test passed." << endl;
+    } else {
+      cout << "Test FAILED!!!" << endl;
+    }
+  }
+  
+  MPI_Finalize();
+  
+  return retval;
+}
@@ -0,0 +1,99 @@
+#include "mpibenchmark.h"
+#include "mpitranspose.h"
+
+using namespace std;
+using namespace utils;
+
+inline void usage()
+{
+  cerr << "Options: " << endl;
+  cerr << "-h\t\t help" << endl;
+  cerr << "-M<int>\t\t maximum message size in bytes" << endl;
+  cerr << "-n<int>\t\t number of iterations per message size" << endl;
+  cerr << "-m<int>\t\t size of transpose to predict" << endl;
+  cerr << "-q\t\t quiet" << endl;
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  size_t maxbytes=160000;
+  unsigned int iterations=200;
+  unsigned int X=1024;
+  bool quiet=false;
+
+  MPI_Init(&argc,&argv);
+
+  int size,rank;
+  MPI_Comm_size(MPI_COMM_WORLD,&size);
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
+  bool main=rank == 0;
+  if(!main)
+    opterr=0;
+
+#ifdef __GNUC__
+  optind=0;
+#endif
+  for (;;) {
+    int c=getopt(argc,argv,"hM:m:n:qt");
+    if (c == -1) break;
+
+    switch (c) {
+      case 0:
+        break;
+      case 'M':
+        maxbytes=atoi(optarg);
+        break;
+      case 'm':
+        X=atoi(optarg);
+        break;
+      case 'n':
+        iterations=atoi(optarg);
+        break;
+      case 'q':
+        quiet=true;
+        break;
+      case 't':
+        break;
+      case 'h':
+      default:
+        if(main)
+          usage();
+    }
+  }
+
+  commbenchmark bench(MPI_COMM_WORLD,maxbytes,32,iterations);
+
+  int retval=0;
+  if(main) {
+    if(!quiet) {
+      cout << "size=" << size << endl << endl;
+      cout << "bytes\ttime\tmodel" << endl;
+      for(unsigned int i=0; i < bench.samples(); ++i)
+        cout << bench.Bytes(i) << "\t" << bench.Time(i) << "\t"
+             << bench.alltoall(size,bench.Bytes(i)) << endl;
+      cout << endl;
+    }
+    cout << "alpha=" << bench.Alpha() << endl;
+    cout << "beta=" << bench.Beta() << endl;
+    cout << "crossover=" << bench.crossover() << endl;
+
+    if(!quiet) {
+      cout << endl << "Predicted " << X << "x" << X
+           << " complex transpose times:" << endl;
+      for(int a=1; a*a <= size; ++a)
+        if(size % a == 0)
+          cout << "a=" << a << ":\t"
+               << bench.transpose(X,X,sizeof(Complex),size,a) << endl;
+    }
+
+    if(!(bench.Alpha() >= 0.0 && bench.Beta() >= 0.0)) {
+      cerr << "Invalid fit" << endl;
+      retval=1;
+    }
+  }
+
+  MPI_Finalize();
+  return retval;
+}
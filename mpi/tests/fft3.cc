@@ -52,6 +52,7 @@ int main(int argc, char* argv[])
   unsigned int nz=0;
 
   bool inplace=true;
+  bool plan=false; // Time the slab and pencil decompositions
   
   bool quiet=false;
   bool test=false;
@@ -67,7 +68,7 @@ int main(int argc, char* argv[])
   optind=0;
 #endif  
   for (;;) {
-    int c = getopt(argc,argv,"htN:S:T:a:i:m:n:s:x:y:z:q");
+    int c = getopt(argc,argv,"hptN:S:T:a:i:m:n:s:x:y:z:q");
     if (c == -1) break;
                 
     switch (c) {
@@ -106,6 +107,9 @@ int main(int argc, char* argv[])
       case 'T':
         fftw::maxthreads=atoi(optarg);
         break;
+      case 'p':
+        plan=true;
+        break;
       case 'q':
         quiet=true;
         break;
@@ -117,6 +121,8 @@ int main(int argc, char* argv[])
         if(rank == 0) {
           usageInplace(3);
           usageTranspose();
+          std::cerr << "-p\t\t choose slab or pencil decomposition by timing"
+                    << std::endl;
         }
         exit(1);
     }
@@ -130,7 +136,10 @@ int main(int argc, char* argv[])
     if(N < 10) N=10;
   }
   
-  MPIgroup group(MPI_COMM_WORLD,nx,ny);
+  MPIgroup *pgroup=plan ?
+    new MPIgroup(MPI_COMM_WORLD,nx,ny,nz,mpiOptions(divisor,alltoall)) :
+    new MPIgroup(MPI_COMM_WORLD,nx,ny);
+  MPIgroup& group=*pgroup;
 
   if(group.size > 1 && provided < MPI_THREAD_FUNNELED)
     fftw::maxthreads=1;
@@ -292,6 +301,7 @@ int main(int argc, char* argv[])
       deleteAlign(g);
   }
   
+  delete pgroup;
   MPI_Finalize();
   
   return retval;
@@ -145,6 +145,27 @@ int main(int argc, char* argv[])
     }
 
 
+    {
+      Complex *g=ComplexAlign(d.n*mz);
+      for(unsigned int i=0; i < d.n*mz; ++i)
+        g[i]=0.0;
+      scatterx(localf(),g,d,mz,group.active);
+      int errors=0;
+      for(unsigned int i=0; i < d.x*d.Y*mz; ++i)
+        if(g[i] != f[i]) ++errors;
+      int total;
+      MPI_Allreduce(&errors,&total,1,MPI_INT,MPI_SUM,group.active);
+      if(main) {
+        if(total == 0) {
+          cout << "OK." << endl;
+        } else {
+          cout << "ERROR!" << endl;
+          retval += 1;
+        }
+      }
+      deleteAlign(g);
+    }
+
     if(!quiet)
       cout << "\nTransposed init:" << endl;
     init(f,d.X,d.Y,d.x0,d.y0,d.x,d.y,mz,true);
@@ -199,6 +220,27 @@ int main(int argc, char* argv[])
         retval += 1;
       }
     }
+
+    {
+      Complex *g=ComplexAlign(d.n*mz);
+      for(unsigned int i=0; i < d.n*mz; ++i)
+        g[i]=0.0;
+      scattery(localf(),g,d,mz,group.active);
+      int errors=0;
+      for(unsigned int i=0; i < d.X*d.y*mz; ++i)
+        if(g[i] != f[i]) ++errors;
+      int total;
+      MPI_Allreduce(&errors,&total,1,MPI_INT,MPI_SUM,group.active);
+      if(main) {
+        if(total == 0) {
+          cout << "OK." << endl;
+        } else {
+          cout << "ERROR!" << endl;
+          retval += 1;
+        }
+      }
+      deleteAlign(g);
+    }
       
     MPI_Barrier(group.active);
   }
@@ -140,6 +140,21 @@ int main(int argc, char* argv[])
       if(!same)
         retval++;
     }
+
+    if(!quiet && main)
+      cout << "Scattering... " << endl;
+    Complex *pG=ComplexAlign(localsize);
+    for(unsigned int i=0; i < localsize; ++i)
+      pG[i]=0.0;
+    scatterxy(f0(),pG,d,group.active);
+    int errors=0;
+    for(unsigned int i=0; i < localsize; ++i)
+      if(pG[i] != pF[i]) ++errors;
+    int total;
+    MPI_Allreduce(&errors,&total,1,MPI_INT,MPI_SUM,group.active);
+    if(total > 0)
+      retval++;
+    deleteAlign(pG);
   }
 
   if(group.rank == 0) {
@@ -0,0 +1,253 @@
+#include "mpiconvolve.h"
+#include "mpiutils.h"
+
+using namespace std;
+using namespace utils;
+using namespace fftwpp;
+using namespace Array;
+
+inline void init(Complex **F, split d)
+{
+  array2<Complex> f(d.X,d.y,F[0]);
+  array2<Complex> g(d.X,d.y,F[1]);
+  for(unsigned int i=0; i < d.X; ++i) {
+    for(unsigned int j=0; j < d.y; j++) {
+      unsigned int jj=d.y0+j;
+      f[i][j]=Complex(i,jj);
+      g[i][j]=Complex(2*i,jj+1);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // Number of iterations.
+  unsigned int N0=1000000;
+  unsigned int N=0;
+  unsigned int Lx=8;
+  unsigned int Ly=8;
+  unsigned int Mx=0;
+  unsigned int My=0;
+  int divisor=0; // Test for best block divisor
+  int alltoall=-1; // Test for best alltoall routine
+
+  unsigned int outlimit=100;
+
+#ifndef __SSE2__
+  fftw::effort |= FFTW_NO_SIMD;
+#endif
+  int retval=0;
+  bool test=false;
+  bool quiet=false;
+
+  int stats=0;
+
+  int provided;
+  MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
+
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+  if(rank != 0) opterr=0;
+#ifdef __GNUC__
+  optind=0;
+#endif
+  for (;;) {
+    int c = getopt(argc,argv,"hqta:m:L:M:N:s:x:y:X:Y:n:T:S:");
+    if (c == -1) break;
+
+    switch (c) {
+      case 0:
+        break;
+      case 'a':
+        divisor=atoi(optarg);
+        break;
+      case 'm':
+        mOption=atoi(optarg);
+        break;
+      case 'L':
+        Lx=Ly=atoi(optarg);
+        break;
+      case 'M':
+        Mx=My=atoi(optarg);
+        break;
+      case 'N':
+        N=atoi(optarg);
+        break;
+      case 's':
+        alltoall=atoi(optarg);
+        break;
+      case 'x':
+        Lx=atoi(optarg);
+        break;
+      case 'y':
+        Ly=atoi(optarg);
+        break;
+      case 'X':
+        Mx=atoi(optarg);
+        break;
+      case 'Y':
+        My=atoi(optarg);
+        break;
+      case 'n':
+        N0=atoi(optarg);
+        break;
+      case 'T':
+        fftw::maxthreads=atoi(optarg);
+        break;
+      case 'S':
+        stats=atoi(optarg);
+        break;
+      case 't':
+        test=true;
+        break;
+      case 'q':
+        quiet=true;
+        break;
+      case 'h':
+      default:
+        if(rank == 0) {
+          usageCommon(2);
+          std::cerr << "-m\t\t subtransform size [0=optimize]" << std::endl;
+          std::cerr << "-L\t\t number of physical data values" << std::endl;
+          std::cerr << "-M\t\t minimal number of padded data values"
+                    << std::endl;
+          std::cerr << "-X\t\t x padded size" << std::endl;
+          std::cerr << "-Y\t\t y padded size" << std::endl;
+          usageTest();
+          usageTranspose();
+        }
+        exit(1);
+    }
+  }
+
+  if(Mx == 0) Mx=2*Lx;
+  if(My == 0) My=2*Ly;
+
+  if(N == 0) {
+    N=N0/Lx/Ly;
+    if(N < 20) N=20;
+  }
+
+  MPIgroup group(MPI_COMM_WORLD,Ly);
+
+  if(group.size > 1 && provided < MPI_THREAD_FUNNELED)
+    fftw::maxthreads=1;
+
+  defaultmpithreads=fftw::maxthreads;
+
+  if(group.rank < group.size) {
+    bool main=group.rank == 0;
+    if(!quiet && main) {
+      seconds();
+      cout << "Configuration: "
+           << group.size << " nodes X " << fftw::maxthreads
+           << " threads/node" << endl;
+      cout << "Using MPI VERSION " << MPI_VERSION << endl;
+    }
+
+    split d(Lx,Ly,group.active);
+
+    ForwardBackward FB;
+
+    // The x residues must agree on every process.
+    unsigned int parm[2];
+    if(main) {
+      fftPad fft(Lx,Mx,FB,d.y);
+      parm[0]=fft.m;
+      parm[1]=fft.q;
+    }
+    MPI_Bcast(parm,2,MPI_UNSIGNED,0,group.active);
+
+    fftPad fftx(Lx,Mx,d.y,parm[0],parm[1],1);
+    fftPad ffty(Ly,My,FB,1);
+    Convolution convolvey(ffty);
+
+    if(!quiet && main) {
+      if(!test)
+        cout << "N=" << N << endl;
+      cout << "Lx=" << Lx << ", Ly=" << Ly << endl;
+      cout << "Mx=" << Mx << ", My=" << My << endl;
+      cout << "mx=" << fftx.m << ", qx=" << fftx.q << endl;
+    }
+
+    Complex **f=new Complex *[2];
+    for(unsigned int a=0; a < 2; ++a)
+      f[a]=ComplexAlign(Lx*d.y);
+    Complex **h=new Complex *[1];
+    h[0]=ComplexAlign(Lx*d.y);
+
+    bool showresult=Lx*Ly < outlimit;
+
+    Convolution2MPI C(fftx,convolvey,d,mpiOptions(divisor,alltoall));
+
+    if(test) {
+      init(f,d);
+
+      Complex **flocal=new Complex *[2];
+      for(unsigned int a=0; a < 2; ++a) {
+        flocal[a]=ComplexAlign(Lx*Ly);
+        gathery(f[a],flocal[a],d,1,group.active);
+      }
+
+      C.convolve(f,h,scaledmultbinary);
+
+      Complex *hgather=ComplexAlign(Lx*Ly);
+      gathery(h[0],hgather,d,1,group.active);
+
+      if(!quiet && showresult) {
+        if(main)
+          cout << "Distributed output:" << endl;
+        show(h[0],Lx,d.y,group.active);
+      }
+
+      if(main) {
+        fftPad fftx0(Lx,Mx,Ly,fftx.m,fftx.q,fftx.D);
+        Convolution2 Clocal(fftx0,convolvey);
+        Complex *hlocal=ComplexAlign(Lx*Ly);
+        Clocal.convolve(flocal,&hlocal,scaledmultbinary);
+        if(!quiet && showresult) {
+          cout << "Local output:" << endl;
+          Array2<Complex> Ahlocal(Lx,Ly,hlocal);
+          cout << Ahlocal << endl;
+        }
+        retval += checkerror(hlocal,hgather,Lx*Ly);
+        deleteAlign(hlocal);
+      }
+
+      deleteAlign(hgather);
+      for(unsigned int a=0; a < 2; ++a)
+        deleteAlign(flocal[a]);
+      delete [] flocal;
+
+      MPI_Barrier(group.active);
+
+    } else {
+      if(!quiet && main)
+        cout << "Initialized after " << seconds() << " seconds." << endl;
+
+      MPI_Barrier(group.active);
+
+      double *T=new double[N];
+      for(unsigned int i=0; i < N; ++i) {
+        init(f,d);
+        if(main) seconds();
+        C.convolve(f,h,scaledmultbinary);
+        if(main) T[i]=seconds();
+      }
+
+      if(main)
+        timings("Hybrid",Lx,T,N,stats);
+      delete [] T;
+    }
+
+    deleteAlign(h[0]);
+    delete [] h;
+    for(unsigned int a=0; a < 2; ++a)
+      deleteAlign(f[a]);
+    delete [] f;
+  }
+
+  MPI_Finalize();
+
+  return retval;
+}
@@ -0,0 +1,259 @@
+#include "mpiconvolution.h"
+#include "utils.h"
+
+using namespace std;
+using namespace utils;
+using namespace fftwpp;
+using namespace Array;
+
+// Row 0 and column my are padding.
+inline void init(Complex **E, Complex **F, Complex **G, split d,
+                 unsigned int mx, unsigned int my, unsigned int M=1)
+{
+  double factor=1.0/cbrt((double) M);
+  for(unsigned int s=0; s < M; ++s) {
+    double S=sqrt(1.0+s);
+    double efactor=1.0/S*factor;
+    double ffactor=(1.0+S)*S*factor;
+    double gfactor=1.0/(1.0+S)*factor;
+    array2<Complex> e(d.X,d.y,E[s]);
+    array2<Complex> f(d.X,d.y,F[s]);
+    array2<Complex> g(d.X,d.y,G[s]);
+    for(unsigned int i=0; i < d.X; ++i) {
+      unsigned int ii=i-1;
+      for(unsigned int j=0; j < d.y; ++j) {
+        unsigned int jj=d.y0+j;
+        if(i == 0 || jj == my) {
+          e[i][j]=f[i][j]=g[i][j]=0.0;
+        } else {
+          e[i][j]=efactor*Complex(ii,jj);
+          f[i][j]=ffactor*Complex(ii+1,jj+2);
+          g[i][j]=gfactor*Complex(2*ii,jj+1);
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // Number of iterations.
+  unsigned int N0=1000000;
+  unsigned int N=0;
+
+#ifndef __SSE2__
+  fftw::effort |= FFTW_NO_SIMD;
+#endif
+  int retval=0;
+
+  int stats=0;
+  unsigned int outlimit=100;
+
+  unsigned int M=1; // Number of terms in dot product
+
+  unsigned int mx=4;
+  unsigned int my=4;
+
+  int divisor=0; // Test for best block divisor
+  int alltoall=-1; // Test for best alltoall routine
+
+  bool quiet=false;
+  bool test=false;
+
+  int provided;
+  MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
+
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+  if(rank != 0) opterr=0;
+#ifdef __GNUC__
+  optind=0;
+#endif
+  for (;;) {
+    int c = getopt(argc,argv,"hqtiM:N:a:m:n:s:x:y:T:S:");
+    if (c == -1) break;
+
+    switch (c) {
+      case 0:
+        break;
+      case 'M':
+        M=atoi(optarg);
+        break;
+      case 'a':
+        divisor=atoi(optarg);
+        break;
+      case 'N':
+        N=atoi(optarg);
+        break;
+      case 'm':
+        mx=my=atoi(optarg);
+        break;
+      case 'q':
+        quiet=true;
+        break;
+      case 's':
+        alltoall=atoi(optarg);
+        break;
+      case 't':
+        test=true;
+        break;
+      case 'x':
+        mx=atoi(optarg);
+        break;
+      case 'y':
+        my=atoi(optarg);
+        break;
+      case 'n':
+        N0=atoi(optarg);
+        break;
+      case 'T':
+        fftw::maxthreads=atoi(optarg);
+        break;
+      case 'S':
+        stats=atoi(optarg);
+        break;
+      case 'i':
+        // Added for compatibility with the OpenMP version.
+        break;
+      case 'h':
+      default:
+        if(rank == 0) {
+          usage(2);
+          usageTranspose();
+        }
+        exit(1);
+    }
+  }
+
+  if(my == 0) my=mx;
+
+  if(N == 0) {
+    N=N0/mx/my;
+    if(N < 10) N=10;
+  }
+
+  unsigned int nx=2*mx;
+  unsigned int nyp=my+1;
+
+  MPIgroup group(MPI_COMM_WORLD,nyp);
+
+  if(group.size > 1 && provided < MPI_THREAD_FUNNELED)
+    fftw::maxthreads=1;
+
+  defaultmpithreads=fftw::maxthreads;
+
+  if(group.rank < group.size) {
+    bool main=group.rank == 0;
+    if(!quiet && main) {
+      seconds();
+      cout << "Configuration: "
+           << group.size << " nodes X " << fftw::maxthreads
+           << " threads/node" << endl;
+      cout << "Using MPI VERSION " << MPI_VERSION << endl;
+    }
+
+    split d(nx,nyp,group.active);
+
+    Complex **E=new Complex *[M];
+    Complex **F=new Complex *[M];
+    Complex **G=new Complex *[M];
+    for(unsigned int s=0; s < M; ++s) {
+      E[s]=ComplexAlign(d.n);
+      F[s]=ComplexAlign(d.n);
+      G[s]=ComplexAlign(d.n);
+    }
+
+    if(!quiet && main) {
+      if(!test)
+        cout << "N=" << N << endl;
+      cout << "M=" << M << endl;
+      cout << "mx=" << mx << ", my=" << my << endl;
+      cout << "nx=" << nx << ", nyp=" << nyp << endl;
+    }
+
+    bool showresult=nx*nyp < outlimit;
+
+    ImplicitHTConvolution2MPI C(mx,my,d,E[0],mpiOptions(divisor,alltoall),M);
+
+    if(test) {
+      init(E,F,G,d,mx,my,M);
+
+      if(!quiet && showresult) {
+        if(main) cout << "\nDistributed input 0:" << endl;
+        show(E[0],d.X,d.y,group.active);
+      }
+
+      Complex **Elocal=new Complex *[M];
+      Complex **Flocal=new Complex *[M];
+      Complex **Glocal=new Complex *[M];
+      for(unsigned int s=0; s < M; ++s) {
+        Elocal[s]=ComplexAlign(nx*nyp);
+        Flocal[s]=ComplexAlign(nx*nyp);
+        Glocal[s]=ComplexAlign(nx*nyp);
+        gathery(E[s],Elocal[s],d,1,group.active);
+        gathery(F[s],Flocal[s],d,1,group.active);
+        gathery(G[s],Glocal[s],d,1,group.active);
+      }
+
+      C.convolve(E,F,G);
+
+      Complex *Egather=ComplexAlign(nx*nyp);
+      gathery(E[0],Egather,d,1,group.active);
+
+      if(main) {
+        ImplicitHTConvolution2 Clocal(mx,my,M);
+        Clocal.convolve(Elocal,Flocal,Glocal);
+        if(!quiet && showresult) {
+          cout << "\nGathered output:" << endl;
+          cout << Array2<Complex>(nx,nyp,Egather) << endl;
+          cout << "Local output:" << endl;
+          cout << Array2<Complex>(nx,nyp,Elocal[0]) << endl;
+        }
+        // Column my is scratch space.
+        retval += checkerror(Elocal[0],Egather,my,nx,nyp);
+      }
+
+      deleteAlign(Egather);
+      for(unsigned int s=0; s < M; ++s) {
+        deleteAlign(Glocal[s]);
+        deleteAlign(Flocal[s]);
+        deleteAlign(Elocal[s]);
+      }
+      delete [] Glocal;
+      delete [] Flocal;
+      delete [] Elocal;
+    } else {
+      if(!quiet && main)
+        cout << "Initialized after " << seconds() << " seconds." << endl;
+
+      MPI_Barrier(group.active);
+
+      double *T=new double[N];
+      for(unsigned int i=0; i < N; ++i) {
+        init(E,F,G,d,mx,my,M);
+        if(main) seconds();
+        C.convolve(E,F,G);
+        if(main) T[i]=seconds();
+      }
+      if(main)
+        timings("Implicit",mx,T,N,stats);
+      delete [] T;
+
+      if(!quiet && showresult)
+        show(E[0],d.X,d.y,group.active);
+    }
+
+    for(unsigned int s=0; s < M; ++s) {
+      deleteAlign(G[s]);
+      deleteAlign(F[s]);
+      deleteAlign(E[s]);
+    }
+    delete [] G;
+    delete [] F;
+    delete [] E;
+  }
+
+  MPI_Finalize();
+
+  return retval;
+}
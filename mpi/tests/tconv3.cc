@@ -0,0 +1,344 @@
+#include "mpiconvolution.h"
+#include "utils.h"
+
+using namespace std;
+using namespace utils;
+using namespace fftwpp;
+using namespace Array;
+
+// Row 0, column 0, and the last z entry are padding.
+inline void init(Complex **E, Complex **F, Complex **G, const split3& d,
+                 unsigned int mz, unsigned int M=1)
+{
+  double factor=1.0/cbrt((double) M);
+  for(unsigned int s=0; s < M; ++s) {
+    double S=sqrt(1.0+s);
+    double efactor=1.0/S*factor;
+    double ffactor=(1.0+S)*S*factor;
+    double gfactor=1.0/(1.0+S)*factor;
+    array3<Complex> e(d.X,d.y,d.z,E[s]);
+    array3<Complex> f(d.X,d.y,d.z,F[s]);
+    array3<Complex> g(d.X,d.y,d.z,G[s]);
+    for(unsigned int i=0; i < d.X; ++i) {
+      for(unsigned int j=0; j < d.y; ++j) {
+        unsigned int jj=d.y0+j;
+        for(unsigned int k=0; k < d.z; ++k) {
+          unsigned int kk=d.z0+k;
+          if(i == 0 || jj == 0 || kk == mz) {
+            e[i][j][k]=f[i][j][k]=g[i][j][k]=0.0;
+          } else {
+            e[i][j][k]=efactor*Complex(i+kk,jj);
+            f[i][j][k]=ffactor*Complex(i+1,jj+kk+2);
+            g[i][j][k]=gfactor*Complex(2*i,jj+1+kk);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Return the Hermitian-extended value of the 2mx x 2my x (mz+1) array f at
+// wavenumber (px,py,pz).
+inline Complex value(const Complex *f, unsigned int mx, unsigned int my,
+                     unsigned int mz, int px, int py, int pz)
+{
+  unsigned int Y=2*my;
+  unsigned int Z=mz+1;
+  return pz >= 0 ? f[((mx+px)*Y+my+py)*Z+pz] :
+    conj(f[((mx-px)*Y+my-py)*Z-pz]);
+}
+
+// Direct 3D Hermitian ternary convolution of Hermitian-symmetrized data.
+void direct(Complex *h, Complex **E, Complex **F, Complex **G,
+            unsigned int mx, unsigned int my, unsigned int mz,
+            unsigned int M)
+{
+  int Mx=mx, My=my, Mz=mz;
+  unsigned int Y=2*my;
+  unsigned int Z=mz+1;
+  for(int kx=1-Mx; kx < Mx; ++kx) {
+    for(int ky=1-My; ky < My; ++ky) {
+      for(int kz=0; kz < Mz; ++kz) {
+        Complex sum=0.0;
+        for(unsigned int s=0; s < M; ++s) {
+          for(int px=1-Mx; px < Mx; ++px) {
+            for(int py=1-My; py < My; ++py) {
+              for(int pz=1-Mz; pz < Mz; ++pz) {
+                Complex e=value(E[s],mx,my,mz,px,py,pz);
+                for(int qx=1-Mx; qx < Mx; ++qx) {
+                  int rx=kx-px-qx;
+                  if(rx <= -Mx || rx >= Mx) continue;
+                  for(int qy=1-My; qy < My; ++qy) {
+                    int ry=ky-py-qy;
+                    if(ry <= -My || ry >= My) continue;
+                    for(int qz=1-Mz; qz < Mz; ++qz) {
+                      int rz=kz-pz-qz;
+                      if(rz <= -Mz || rz >= Mz) continue;
+                      sum += e*value(F[s],mx,my,mz,qx,qy,qz)*
+                        value(G[s],mx,my,mz,rx,ry,rz);
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+        h[((mx+kx)*Y+my+ky)*Z+kz]=sum;
+      }
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // Number of iterations.
+  unsigned int N0=1000000;
+  unsigned int N=0;
+
+#ifndef __SSE2__
+  fftw::effort |= FFTW_NO_SIMD;
+#endif
+  int retval=0;
+
+  int stats=0;
+  unsigned int outlimit=300;
+
+  unsigned int M=1; // Number of terms in dot product
+
+  unsigned int mx=4;
+  unsigned int my=4;
+  unsigned int mz=4;
+
+  int divisor=0; // Test for best block divisor
+  int alltoall=-1; // Test for best alltoall routine
+
+  bool quiet=false;
+  bool test=false;
+
+  int provided;
+  MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
+
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+  if(rank != 0) opterr=0;
+#ifdef __GNUC__
+  optind=0;
+#endif
+  for (;;) {
+    int c = getopt(argc,argv,"hqtiM:N:a:m:n:s:x:y:z:T:S:");
+    if (c == -1) break;
+
+    switch (c) {
+      case 0:
+        break;
+      case 'M':
+        M=atoi(optarg);
+        break;
+      case 'a':
+        divisor=atoi(optarg);
+        break;
+      case 'N':
+        N=atoi(optarg);
+        break;
+      case 'm':
+        mx=my=mz=atoi(optarg);
+        break;
+      case 'q':
+        quiet=true;
+        break;
+      case 's':
+        alltoall=atoi(optarg);
+        break;
+      case 't':
+        test=true;
+        break;
+      case 'x':
+        mx=atoi(optarg);
+        break;
+      case 'y':
+        my=atoi(optarg);
+        break;
+      case 'z':
+        mz=atoi(optarg);
+        break;
+      case 'n':
+        N0=atoi(optarg);
+        break;
+      case 'T':
+        fftw::maxthreads=atoi(optarg);
+        break;
+      case 'S':
+        stats=atoi(optarg);
+        break;
+      case 'i':
+        // Added for compatibility with the OpenMP version.
+        break;
+      case 'h':
+      default:
+        if(rank == 0) {
+          usage(3);
+          usageTranspose();
+        }
+        exit(1);
+    }
+  }
+
+  if(my == 0) my=mx;
+  if(mz == 0) mz=mx;
+
+  if(N == 0) {
+    N=N0/mx/my/mz;
+    if(N < 10) N=10;
+  }
+
+  unsigned int nx=2*mx;
+  unsigned int ny=2*my;
+  unsigned int nzp=mz+1;
+
+  int size;
+  MPI_Comm_size(MPI_COMM_WORLD,&size);
+  unsigned int x=ceilquotient(nx,size);
+  unsigned int y=ceilquotient(ny,size);
+  bool allowpencil=nx*y == x*ny;
+
+  MPIgroup group(MPI_COMM_WORLD,ny,nzp,allowpencil);
+
+  if(group.size > 1 && provided < MPI_THREAD_FUNNELED)
+    fftw::maxthreads=1;
+
+  defaultmpithreads=fftw::maxthreads;
+
+  if(group.rank < group.size) {
+    bool main=group.rank == 0;
+    if(!quiet && main) {
+      seconds();
+      cout << "Configuration: "
+           << group.size << " nodes X " << fftw::maxthreads
+           << " threads/node" << endl;
+      cout << "Using MPI VERSION " << MPI_VERSION << endl;
+    }
+
+    split3 d(nx,ny,nzp,group,true);
+
+    Complex **E=new Complex *[M];
+    Complex **F=new Complex *[M];
+    Complex **G=new Complex *[M];
+    for(unsigned int s=0; s < M; ++s) {
+      E[s]=ComplexAlign(d.n);
+      F[s]=ComplexAlign(d.n);
+      G[s]=ComplexAlign(d.n);
+    }
+
+    if(!quiet && main) {
+      if(!test)
+        cout << "N=" << N << endl;
+      cout << "M=" << M << endl;
+      cout << "mx=" << mx << ", my=" << my << ", mz=" << mz << endl;
+      cout << "nx=" << nx << ", ny=" << ny << ", nzp=" << nzp << endl;
+    }
+
+    bool showresult=nx*ny*nzp < outlimit;
+
+    ImplicitHTConvolution3MPI C(mx,my,mz,d,E[0],mpiOptions(divisor,alltoall),
+                                M);
+
+    if(test) {
+      init(E,F,G,d,mz,M);
+
+      if(!quiet && showresult) {
+        if(main) cout << "\nDistributed input 0:" << endl;
+        show(E[0],d.X,d.y,d.z,group.active);
+      }
+
+      unsigned int n=d.X*d.Y*d.Z;
+      Complex **Elocal=new Complex *[M];
+      Complex **Flocal=new Complex *[M];
+      Complex **Glocal=new Complex *[M];
+      for(unsigned int s=0; s < M; ++s) {
+        if(main) {
+          Elocal[s]=ComplexAlign(n);
+          Flocal[s]=ComplexAlign(n);
+          Glocal[s]=ComplexAlign(n);
+        }
+        gatheryz(E[s],Elocal[s],d,group.active);
+        gatheryz(F[s],Flocal[s],d,group.active);
+        gatheryz(G[s],Glocal[s],d,group.active);
+      }
+
+      C.convolve(E,F,G);
+
+      Complex *Egather=main ? ComplexAlign(n) : NULL;
+      gatheryz(E[0],Egather,d,group.active);
+
+      if(main) {
+        for(unsigned int s=0; s < M; ++s) {
+          HermitianSymmetrizeXY(mx,my,nzp,mx,my,Elocal[s]);
+          HermitianSymmetrizeXY(mx,my,nzp,mx,my,Flocal[s]);
+          HermitianSymmetrizeXY(mx,my,nzp,mx,my,Glocal[s]);
+        }
+        Complex *h=ComplexAlign(n);
+        direct(h,Elocal,Flocal,Glocal,mx,my,mz,M);
+        if(!quiet && showresult) {
+          cout << "\nGathered output:" << endl;
+          show(Egather,d.X,d.Y,d.Z,0,0,0,d.X,d.Y,d.Z);
+          cout << "Direct output:" << endl;
+          show(h,d.X,d.Y,d.Z,0,0,0,d.X,d.Y,d.Z);
+        }
+        // Ignore the padding.
+        for(unsigned int i=0; i < d.X; ++i) {
+          for(unsigned int j=0; j < d.Y; ++j) {
+            unsigned int ij=(i*d.Y+j)*d.Z;
+            if(i == 0 || j == 0)
+              for(unsigned int k=0; k < d.Z; ++k)
+                h[ij+k]=Egather[ij+k]=0.0;
+            else
+              h[ij+mz]=Egather[ij+mz]=0.0;
+          }
+        }
+        retval += checkerror(h,Egather,n);
+        deleteAlign(h);
+        deleteAlign(Egather);
+        for(unsigned int s=0; s < M; ++s) {
+          deleteAlign(Glocal[s]);
+          deleteAlign(Flocal[s]);
+          deleteAlign(Elocal[s]);
+        }
+      }
+      delete [] Glocal;
+      delete [] Flocal;
+      delete [] Elocal;
+    } else {
+      if(!quiet && main)
+        cout << "Initialized after " << seconds() << " seconds." << endl;
+
+      MPI_Barrier(group.active);
+
+      double *T=new double[N];
+      for(unsigned int i=0; i < N; ++i) {
+        init(E,F,G,d,mz,M);
+        if(main) seconds();
+        C.convolve(E,F,G);
+        if(main) T[i]=seconds();
+      }
+      if(main)
+        timings("Implicit",mx,T,N,stats);
+      delete [] T;
+
+      if(!quiet && showresult)
+        show(E[0],d.X,d.y,d.z,group.active);
+    }
+
+    for(unsigned int s=0; s < M; ++s) {
+      deleteAlign(G[s]);
+      deleteAlign(F[s]);
+      deleteAlign(E[s]);
+    }
+    delete [] G;
+    delete [] F;
+    delete [] E;
+  }
+
+  MPI_Finalize();
+
+  return retval;
+}
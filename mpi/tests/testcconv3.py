@@ -78,6 +78,18 @@ def main(argv):
                             args.append("-tq")
                             testcases.append(args)
 
+        # Pipelined x chunks, including y not divisible by the process count.
+        for X, Y, Z in [(8,5,3),(8,7,2),(12,7,5)]:
+            for C in [2,0]:
+                args = []
+                args.append("-x" + str(X))
+                args.append("-y" + str(Y))
+                args.append("-z" + str(Z))
+                args.append("-c" + str(C))
+                args.append("-N1")
+                args.append("-tq")
+                testcases.append(args)
+
         tstart = time.time()
         ntest = len(testcases)*len(Plist)
         print("Running", ntest, "tests.")
@@ -63,15 +63,17 @@ def main(argv):
                 for Z in Zlist:
                     for P in Plist:
                         for a in range(1,int(sqrt(P)+1.5)):
-                            for s in range(0,3):
-                                args = []
-                                args.append("-x" + str(X))
-                                args.append("-y" + str(Y))
-                                args.append("-z" + str(Z))
-                                args.append("-s" + str(s))
-                                args.append("-a" + str(a))
-                                args.append("-tq")
-                                argslist.append(args)
+                            for s in range(0,5):
+                                for b in range(0,2):
+                                    args = []
+                                    args.append("-x" + str(X))
+                                    args.append("-y" + str(Y))
+                                    args.append("-z" + str(Z))
+                                    args.append("-s" + str(s))
+                                    args.append("-a" + str(a))
+                                    args.append("-b" + str(b))
+                                    args.append("-tq")
+                                    argslist.append([P,args])
 
 
         print("Running " + str(len(argslist)) + " tests:")
@@ -84,7 +86,7 @@ def main(argv):
         nfails = 0
                                 
         itest = 0
-        for args in argslist:
+        for P, args in argslist:
             print("test", itest, "of", len(argslist), ":",)
             itest += 1
 
@@ -41,6 +41,9 @@ inline void usage()
   cerr << "-p<int>\t\t which part of the transpose to time" << endl;
   usageTranspose();
   cerr << "-L\t\t locally transpose output" << endl;
+  cerr << "-g<int>\t\t processes per shared-memory group [0=node]" << endl;
+  cerr << "-b<int>\t\t non-divisible layout [0=block], 1=balanced, -1=tune"
+       << endl;
   exit(1);
 }
 
@@ -74,7 +77,7 @@ int main(int argc, char **argv)
   optind=0;
 #endif  
   for (;;) {
-    int c=getopt(argc,argv,"hN:A:a:m:n:s:T:S:x:y:z:qt");
+    int c=getopt(argc,argv,"hN:A:a:b:g:m:n:s:T:S:x:y:z:qt");
     if (c == -1) break;
                 
     switch (c) {
@@ -89,6 +92,12 @@ int main(int argc, char **argv)
       case 'a':
         a=atoi(optarg);
         break;
+      case 'b':
+        balance=atoi(optarg);
+        break;
+      case 'g':
+        shmgroup=atoi(optarg);
+        break;
       case 'm':
         X=Y=atoi(optarg);
         break;
@@ -13,6 +13,7 @@ unsigned int mOption=0;
 unsigned int DOption=0;
 
 int IOption=-1;
+size_t ROption=0;
 
 unsigned int A=2; // number of inputs
 unsigned int B=1; // number of outputs
@@ -50,6 +51,32 @@ void realmultbinary(Complex **F, unsigned int e, unsigned int threads)
     );
 }
 
+// F0[j] *= scale*F1[j];
+void scaledmultbinary(Complex **F, unsigned int e, double scale,
+                      unsigned int threads)
+{
+  Complex *F0=F[0];
+  Complex *F1=F[1];
+
+  PARALLEL(
+    for(unsigned int j=0; j < e; ++j)
+      F0[j] *= scale*F1[j];
+    );
+}
+
+// F0[j] *= scale*F1[j];
+void scaledrealmultbinary(Complex **F, unsigned int e, double scale,
+                          unsigned int threads)
+{
+  double *F0=(double *) F[0];
+  double *F1=(double *) F[1];
+
+  PARALLEL(
+    for(unsigned int j=0; j < e; ++j)
+      F0[j] *= scale*F1[j];
+    );
+}
+
 unsigned int nextfftsize(unsigned int m)
 {
   unsigned int N=-1;
@@ -160,6 +187,10 @@ void fftBase::OptBase::scan(unsigned int L, unsigned int M, Application& app,
       ++i;
     }
 
+  if(T == DBL_MAX && ROption > 0)
+    cerr << "WARNING: no configuration fits within " << ROption
+         << " bytes" << endl;
+
   unsigned int p=ceilquotient(L,m);
   cout << endl;
   cout << "Optimal values:" << endl;
@@ -173,7 +204,7 @@ void fftBase::OptBase::scan(unsigned int L, unsigned int M, Application& app,
 
 fftBase::~fftBase()
 {
-  if(q > 1) {
+  if(planned && q > 1) {
     if(Zetaq)
       deleteAlign(Zetaq);
     deleteAlign(Zetaqm+m);
@@ -205,6 +236,27 @@ double fftBase::meantime(Application& app, double *Stdev)
   return 0.0;
 }
 
+bool fftBase::OptBase::fits(fftBase& sizes)
+{
+  size_t bytes=sizes.workMemory();
+  bool fits=ROption == 0 || bytes <= ROption;
+  if(ROption > 0) {
+    cout << "m=" << sizes.m << ", q=" << sizes.q << ", D=" << sizes.D
+         << ": " << bytes << " bytes";
+    if(!fits)
+      cout << " exceeds budget" << endl;
+  }
+  return fits;
+}
+
+double fftBase::OptBase::meantime(fftBase& fft, Application& app)
+{
+  double t=fft.meantime(app);
+  if(ROption > 0)
+    cout << ", t=" << t << endl;
+  return t;
+}
+
 void fftBase::initialize(Complex *f, Complex *g)
 {
   for(unsigned int j=0; j < L; ++j) {
@@ -243,13 +295,41 @@ void fftBase::common()
   M=m*q;
   Pad=&fftBase::padNone;
   Zetaqp=Zetaq=NULL;
+  planned=false;
 }
 
-void fftPad::init()
+void fftPad::parameters()
 {
   common();
 //    if(m >  M) M=m;
 
+  if(q == 1) {
+    Q=1;
+    b=C*M;
+  } else if(twop()) {
+    Q=n=q;
+    b=Cm*p/2;
+  } else {
+    Q=p > 1 ? n : q;
+    b=Cm*p;
+  }
+}
+
+unsigned int fftPad::twiddleSize()
+{
+  if(q == 1) return 0;
+  unsigned int size=(q-1)*m; // Zetaqm
+  if(twop())
+    size += q+(q-1)*(L-m); // Zetaq and Zetaqm2
+  else if(p > 1)
+    size += (n-1)*(p-1); // Zetaqp
+  return size;
+}
+
+void fftPad::init()
+{
+  parameters();
+
   if(q == 1) {
     if(C == 1) {
       Forward=&fftBase::forwardExplicit;
@@ -263,22 +343,18 @@ void fftPad::init()
     fftm=new mfft1d(m,1,C, C,1, G);
     ifftm=new mfft1d(m,-1,C, C,1, G);
     deleteAlign(G);
-    Q=1;
-    b=C*M;
   } else {
     double twopibyN=twopi/M;
     double twopibyq=twopi/q;
 
-    bool twop=p == 2 && 2*n != q;
+    bool twop=this->twop();
 
     unsigned int d;
 
     if(twop) {
       initZetaq();
-      b=Cm*p/2;
       d=C*D;
     } else {
-      b=Cm*p;
       d=C*D*p;
     }
 
@@ -311,7 +387,6 @@ void fftPad::init()
         Forward=&fftBase::forwardInnerMany;
         Backward=&fftBase::backwardInnerMany;
       }
-      Q=n;
       Zetaqp=ComplexAlign((n-1)*(p-1))-p;
       for(unsigned int r=1; r < n; ++r)
         for(unsigned int t=1; t < p; ++t)
@@ -332,7 +407,6 @@ void fftPad::init()
         if(repad())
           Pad=&fftBase::padMany;
       }
-      Q=q;
     }
 
     if(C == 1) {
@@ -359,9 +433,11 @@ void fftPad::init()
 
   fftBase::Forward=Forward;
   fftBase::Backward=Backward;
+  planned=true;
 }
 
 fftPad:: ~fftPad() {
+  if(!planned) return;
   if(q == 1) {
     delete fftm;
     delete ifftm;
@@ -474,7 +550,7 @@ void fftPad::forward(Complex *f, Complex *F0, unsigned int r0, Complex *W)
     F[0]=f[0];
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=1; s < L; ++s)
-      F[s]=Zetar[s]*f[s];
+      STORE(F+s,ZMULT(LOAD(Zetar+s),LOAD(f+s)));
   }
   (D0 == D ? fftm : fftm2)->fft(W,F0);
 }
@@ -506,9 +582,11 @@ void fftPad::forwardMany(Complex *f, Complex *F, unsigned int r, Complex *W) {
       unsigned Cs=C*s;
       Complex *Fs=W+Cs;
       Complex *fs=f+Cs;
-      Complex Zetars=Zetar[s];
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
       for(unsigned int c=0; c < C; ++c)
-        Fs[c]=Zetars*fs[c];
+        STORE(Fs+c,ZMULT(X,Y,LOAD(fs+c)));
     }
   }
   fftm->fft(W,F);
@@ -532,13 +610,16 @@ void fftPad::forward2(Complex *f, Complex *F0, unsigned int r0, Complex *W)
   for(unsigned int d=first; d < D0; ++d) {
     Complex *F=W+m*d;
     unsigned int r=r0+d;
-    Complex Zetaqr=Zetaq[r];
-    F[0]=f[0]+Zetaqr*f[m];
+    Vec Zetaqr=LOAD(Zetaq+r);
+    Vec X=UNPACKL(Zetaqr,Zetaqr);
+    Vec Y=UNPACKH(CONJ(Zetaqr),Zetaqr);
+    Complex *fm=f+m;
+    STORE(F,LOAD(f)+ZMULT(X,Y,LOAD(fm)));
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=1; s < Lm; ++s)
-      F[s]=Zetar[s]*(f[s]+Zetaqr*f[m+s]);
+      STORE(F+s,ZMULT(LOAD(Zetar+s),LOAD(f+s)+ZMULT(X,Y,LOAD(fm+s))));
     for(unsigned int s=Lm; s < m; ++s)
-      F[s]=Zetar[s]*f[s];
+      STORE(F+s,ZMULT(LOAD(Zetar+s),LOAD(f+s)));
   }
   (D0 == D ? fftm : fftm2)->fft(W,F0);
 }
@@ -565,27 +646,33 @@ void fftPad::forward2Many(Complex *f, Complex *F, unsigned int r, Complex *W)
         Fs[c]=fs[c];
     }
   } else {
-    Complex Zetaqr=Zetaq[r];
+    Vec Zetaqr=LOAD(Zetaq+r);
+    Vec Xq=UNPACKL(Zetaqr,Zetaqr);
+    Vec Yq=UNPACKH(CONJ(Zetaqr),Zetaqr);
     Complex *fm=f+Cm;
     for(unsigned int c=0; c < C; ++c)
-      W[c]=f[c]+Zetaqr*fm[c];
+      STORE(W+c,LOAD(f+c)+ZMULT(Xq,Yq,LOAD(fm+c)));
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=1; s < Lm; ++s) {
       unsigned int Cs=C*s;
       Complex *Fs=W+Cs;
       Complex *fs=f+Cs;
-      Complex *fms=f+Cm+Cs;
-      Complex Zetars=Zetar[s];
+      Complex *fms=fm+Cs;
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
       for(unsigned int c=0; c < C; ++c)
-        Fs[c]=Zetars*(fs[c]+Zetaqr*fms[c]);
+        STORE(Fs+c,ZMULT(X,Y,LOAD(fs+c)+ZMULT(Xq,Yq,LOAD(fms+c))));
     }
     for(unsigned int s=Lm; s < m; ++s) {
       unsigned int Cs=C*s;
       Complex *Fs=W+Cs;
       Complex *fs=f+Cs;
-      Complex Zetars=Zetar[s];
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
       for(unsigned int c=0; c < C; ++c)
-        Fs[c]=Zetars*fs[c];
+        STORE(Fs+c,ZMULT(X,Y,LOAD(fs+c)));
     }
   }
   fftm->fft(W,F);
@@ -625,7 +712,7 @@ void fftPad::forwardInner(Complex *f, Complex *F0, unsigned int r0, Complex *W)
       Complex *Ft=W+m*t;
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s)
-        Ft[s] *= Zetar[s];
+        STORE(Ft+s,ZMULT(LOAD(Zetar+s),LOAD(Ft+s)));
     }
   }
 
@@ -639,16 +726,20 @@ void fftPad::forwardInner(Complex *f, Complex *F0, unsigned int r0, Complex *W)
       unsigned int mt=m*t;
       Complex *Ft=F+mt;
       Complex *ft=f+mt;
-      Complex Zeta=Zetaqr[t];
+      Vec Zeta=LOAD(Zetaqr+t);
+      Vec X=UNPACKL(Zeta,Zeta);
+      Vec Y=UNPACKH(CONJ(Zeta),Zeta);
       for(unsigned int s=0; s < m; ++s)
-        Ft[s]=Zeta*ft[s];
+        STORE(Ft+s,ZMULT(X,Y,LOAD(ft+s)));
     }
     unsigned int mt=m*pm1;
     Complex *Ft=F+mt;
     Complex *ft=f+mt;
-    Complex Zeta=Zetaqr[pm1];
+    Vec Zeta=LOAD(Zetaqr+pm1);
+    Vec X=UNPACKL(Zeta,Zeta);
+    Vec Y=UNPACKH(CONJ(Zeta),Zeta);
     for(unsigned int s=0; s < stop; ++s)
-      Ft[s]=Zeta*ft[s];
+      STORE(Ft+s,ZMULT(X,Y,LOAD(ft+s)));
     for(unsigned int s=stop; s < m; ++s)
       Ft[s]=0.0;
 
@@ -658,7 +749,7 @@ void fftPad::forwardInner(Complex *f, Complex *F0, unsigned int r0, Complex *W)
       Complex *Ft=F+m*t;
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s)
-        Ft[s] *= Zetar[s];
+        STORE(Ft+s,ZMULT(LOAD(Zetar+s),LOAD(Ft+s)));
     }
   }
   (D0 == D ? fftm : fftm2)->fft(W,F0);
@@ -707,9 +798,11 @@ void fftPad::forwardInnerMany(Complex *f, Complex *F, unsigned int r, Complex *W
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s) {
         Complex *Fts=Ft+C*s;
-        Complex Zetars=Zetar[s];
+        Vec Zetars=LOAD(Zetar+s);
+        Vec X=UNPACKL(Zetars,Zetars);
+        Vec Y=UNPACKH(CONJ(Zetars),Zetars);
         for(unsigned int c=0; c < C; ++c)
-          Fts[c] *= Zetars;
+          STORE(Fts+c,ZMULT(X,Y,LOAD(Fts+c)));
       }
     }
   } else {
@@ -725,24 +818,28 @@ void fftPad::forwardInnerMany(Complex *f, Complex *F, unsigned int r, Complex *W
       unsigned int Cmt=Cm*t;
       Complex *Ft=W+Cmt;
       Complex *ft=f+Cmt;
-      Complex Zeta=Zetaqr[t];
+      Vec Zeta=LOAD(Zetaqr+t);
+      Vec X=UNPACKL(Zeta,Zeta);
+      Vec Y=UNPACKH(CONJ(Zeta),Zeta);
       for(unsigned int s=0; s < m; ++s) {
         unsigned int Cs=C*s;
         Complex *Fts=Ft+Cs;
         Complex *fts=ft+Cs;
         for(unsigned int c=0; c < C; ++c)
-          Fts[c]=Zeta*fts[c];
+          STORE(Fts+c,ZMULT(X,Y,LOAD(fts+c)));
       }
     }
     Complex *Ft=W+Cm*pm1;
     Complex *ft=f+Cm*pm1;
-    Complex Zeta=Zetaqr[pm1];
+    Vec Zeta=LOAD(Zetaqr+pm1);
+    Vec X=UNPACKL(Zeta,Zeta);
+    Vec Y=UNPACKH(CONJ(Zeta),Zeta);
     for(unsigned int s=0; s < stop; ++s) {
       unsigned int Cs=C*s;
       Complex *Fts=Ft+Cs;
       Complex *fts=ft+Cs;
       for(unsigned int c=0; c < C; ++c)
-        Fts[c]=Zeta*fts[c];
+        STORE(Fts+c,ZMULT(X,Y,LOAD(fts+c)));
     }
     for(unsigned int s=stop; s < m; ++s) {
       Complex *Fts=Ft+C*s;
@@ -757,9 +854,11 @@ void fftPad::forwardInnerMany(Complex *f, Complex *F, unsigned int r, Complex *W
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s) {
         Complex *Fts=Ft+C*s;
-        Complex Zetars=Zetar[s];
+        Vec Zetars=LOAD(Zetar+s);
+        Vec X=UNPACKL(Zetars,Zetars);
+        Vec Y=UNPACKH(CONJ(Zetars),Zetars);
         for(unsigned int c=0; c < C; ++c)
-          Fts[c] *= Zetars;
+          STORE(Fts+c,ZMULT(X,Y,LOAD(Fts+c)));
       }
     }
   }
@@ -789,7 +888,7 @@ void fftPad::backward(Complex *F0, Complex *f, unsigned int r0, Complex *W)
     f[0] += F[0];
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=1; s < L; ++s)
-      f[s] += conj(Zetar[s])*F[s];
+      STORE(f+s,LOAD(f+s)+ZMULTC(LOAD(Zetar+s),LOAD(F+s)));
   }
 }
 
@@ -815,9 +914,11 @@ void fftPad::backwardMany(Complex *F, Complex *f, unsigned int r, Complex *W)
       unsigned int Cs=C*s;
       Complex *fs=f+Cs;
       Complex *Fs=W+Cs;
-      Complex Zetars=Zetar[s];
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(Zetars,CONJ(Zetars));
       for(unsigned int c=0; c < C; ++c)
-        fs[c] += conj(Zetars)*Fs[c];
+        STORE(fs+c,LOAD(fs+c)+ZMULT(X,Y,LOAD(Fs+c)));
     }
   }
 }
@@ -846,11 +947,11 @@ void fftPad::backward2(Complex *F0, Complex *f, unsigned int r0, Complex *W)
     f[0] += F[0];
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=1; s < m; ++s)
-      f[s] += conj(Zetar[s])*F[s];
+      STORE(f+s,LOAD(f+s)+ZMULTC(LOAD(Zetar+s),LOAD(F+s)));
     Complex *Zetar2=Zetaqm2+Lm*r;
     Complex *Fm=F-m;
     for(unsigned int s=m; s < L; ++s)
-      f[s] += conj(Zetar2[s])*Fm[s];
+      STORE(f+s,LOAD(f+s)+ZMULTC(LOAD(Zetar2+s),LOAD(Fm+s)));
   }
 }
 
@@ -885,9 +986,11 @@ void fftPad::backward2Many(Complex *F, Complex *f, unsigned int r, Complex *W)
       unsigned int Cs=C*s;
       Complex *fs=f+Cs;
       Complex *Fs=W+Cs;
-      Complex Zetars=conj(Zetar[s]);
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(Zetars,CONJ(Zetars));
       for(unsigned int c=0; c < C; ++c)
-        fs[c] += Zetars*Fs[c];
+        STORE(fs+c,LOAD(fs+c)+ZMULT(X,Y,LOAD(Fs+c)));
     }
     Complex *Zetar2=Zetaqm2+Lm*r;
     Complex *WCm=W-Cm;
@@ -895,9 +998,11 @@ void fftPad::backward2Many(Complex *F, Complex *f, unsigned int r, Complex *W)
       unsigned int Cs=C*s;
       Complex *fs=f+Cs;
       Complex *Fs=WCm+Cs;
-      Complex Zetars2=conj(Zetar2[s]);
+      Vec Zetars2=LOAD(Zetar2+s);
+      Vec X=UNPACKL(Zetars2,Zetars2);
+      Vec Y=UNPACKH(Zetars2,CONJ(Zetars2));
       for(unsigned int c=0; c < C; ++c)
-        fs[c] += Zetars2*Fs[c];
+        STORE(fs+c,LOAD(fs+c)+ZMULT(X,Y,LOAD(Fs+c)));
     }
   }
 }
@@ -921,7 +1026,7 @@ void fftPad::backwardInner(Complex *F0, Complex *f, unsigned int r0, Complex *W)
       Complex *Ft=W+m*t;
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s)
-        Ft[s] *= conj(Zetar[s]);
+        STORE(Ft+s,ZMULTC(LOAD(Zetar+s),LOAD(Ft+s)));
     }
     ifftp->fft(W);
     for(unsigned int t=0; t < pm1; ++t) {
@@ -946,7 +1051,7 @@ void fftPad::backwardInner(Complex *F0, Complex *f, unsigned int r0, Complex *W)
       Complex *Ft=F+m*t;
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s)
-        Ft[s] *= conj(Zetar[s]);
+        STORE(Ft+s,ZMULTC(LOAD(Zetar+s),LOAD(Ft+s)));
     }
     ifftp->fft(F);
     for(unsigned int s=0; s < m; ++s)
@@ -956,16 +1061,20 @@ void fftPad::backwardInner(Complex *F0, Complex *f, unsigned int r0, Complex *W)
       unsigned int mt=m*t;
       Complex *ft=f+mt;
       Complex *Ft=F+mt;
-      Complex Zeta=conj(Zetaqr[t]);
+      Vec Zeta=LOAD(Zetaqr+t);
+      Vec X=UNPACKL(Zeta,Zeta);
+      Vec Y=UNPACKH(Zeta,CONJ(Zeta));
       for(unsigned int s=0; s < m; ++s)
-        ft[s] += Zeta*Ft[s];
+        STORE(ft+s,LOAD(ft+s)+ZMULT(X,Y,LOAD(Ft+s)));
     }
     unsigned int mt=m*pm1;
     Complex *Ft=F+mt;
     Complex *ft=f+mt;
-    Complex Zeta=conj(Zetaqr[pm1]);
+    Vec Zeta=LOAD(Zetaqr+pm1);
+    Vec X=UNPACKL(Zeta,Zeta);
+    Vec Y=UNPACKH(Zeta,CONJ(Zeta));
     for(unsigned int s=0; s < stop; ++s)
-      ft[s] += Zeta*Ft[s];
+      STORE(ft+s,LOAD(ft+s)+ZMULT(X,Y,LOAD(Ft+s)));
   }
 }
 
@@ -987,9 +1096,11 @@ void fftPad::backwardInnerMany(Complex *F, Complex *f, unsigned int r, Complex *
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s) {
         Complex *Fts=Ft+C*s;
-        Complex Zetars=Zetar[s];
+        Vec Zetars=LOAD(Zetar+s);
+        Vec X=UNPACKL(Zetars,Zetars);
+        Vec Y=UNPACKH(Zetars,CONJ(Zetars));
         for(unsigned int c=0; c < C; ++c)
-          Fts[c] *= conj(Zetar[s]);
+          STORE(Fts+c,ZMULT(X,Y,LOAD(Fts+c)));
       }
     }
     ifftp->fft(W);
@@ -1022,9 +1133,11 @@ void fftPad::backwardInnerMany(Complex *F, Complex *f, unsigned int r, Complex *
       Complex *Zetar=Zetaqm+m*R;
       for(unsigned int s=1; s < m; ++s) {
         Complex *Fts=Ft+C*s;
-        Complex Zetars=conj(Zetar[s]);
+        Vec Zetars=LOAD(Zetar+s);
+        Vec X=UNPACKL(Zetars,Zetars);
+        Vec Y=UNPACKH(Zetars,CONJ(Zetars));
         for(unsigned int c=0; c < C; ++c)
-          Fts[c] *= Zetars;
+          STORE(Fts+c,ZMULT(X,Y,LOAD(Fts+c)));
       }
     }
     ifftp->fft(W);
@@ -1040,24 +1153,28 @@ void fftPad::backwardInnerMany(Complex *F, Complex *f, unsigned int r, Complex *
       unsigned int Cmt=Cm*t;
       Complex *ft=f+Cmt;
       Complex *Ft=W+Cmt;
-      Complex Zeta=conj(Zetaqr[t]);
+      Vec Zeta=LOAD(Zetaqr+t);
+      Vec X=UNPACKL(Zeta,Zeta);
+      Vec Y=UNPACKH(Zeta,CONJ(Zeta));
       for(unsigned int s=0; s < m; ++s) {
         unsigned int Cs=C*s;
         Complex *fts=ft+Cs;
         Complex *Fts=Ft+Cs;
         for(unsigned int c=0; c < C; ++c)
-          fts[c] += Zeta*Fts[c];
+          STORE(fts+c,LOAD(fts+c)+ZMULT(X,Y,LOAD(Fts+c)));
       }
     }
     Complex *ft=f+Cm*pm1;
     Complex *Ft=W+Cm*pm1;
-    Complex Zeta=conj(Zetaqr[pm1]);
+    Vec Zeta=LOAD(Zetaqr+pm1);
+    Vec X=UNPACKL(Zeta,Zeta);
+    Vec Y=UNPACKH(Zeta,CONJ(Zeta));
     for(unsigned int s=0; s < stop; ++s) {
       unsigned int Cs=C*s;
       Complex *fts=ft+Cs;
       Complex *Fts=Ft+Cs;
       for(unsigned int c=0; c < C; ++c)
-        fts[c] += Zeta*Fts[c];
+        STORE(fts+c,LOAD(fts+c)+ZMULT(X,Y,LOAD(Fts+c)));
     }
   }
 }
@@ -1170,14 +1287,17 @@ void fftPadCentered::forward2(Complex *f, Complex *F0, unsigned int r0, Complex
   for(unsigned int d=first; d < D0; ++d) {
     Complex *F=W+m*d;
     unsigned int r=r0+d;
-    Complex Zetaqr=conj(Zetaq[r]);
+    Vec Zetaqr=LOAD(Zetaq+r);
+    Vec X=UNPACKL(Zetaqr,Zetaqr);
+    Vec Y=UNPACKH(Zetaqr,CONJ(Zetaqr));
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=0; s < mH; ++s)
-      F[s]=Zetar[s]*fH[s];
+      STORE(F+s,ZMULT(LOAD(Zetar+s),LOAD(fH+s)));
     for(unsigned int s=mH; s < LH; ++s)
-      F[s]=Zetar[s]*(Zetaqr*fmH[s]+fH[s]);
+      STORE(F+s,ZMULT(LOAD(Zetar+s),ZMULT(X,Y,LOAD(fmH+s))+LOAD(fH+s)));
     for(unsigned int s=LH; s < m; ++s)
-      F[s]=Zetar[s]*Zetaqr*fmH[s]; // TODO: Can we use Zetaqm2 here?
+      // TODO: Can we use Zetaqm2 here?
+      STORE(F+s,ZMULT(LOAD(Zetar+s),ZMULT(X,Y,LOAD(fmH+s))));
   }
   (D0 == D ? fftm : fftm2)->fft(W,F0);
 }
@@ -1215,33 +1335,41 @@ void fftPadCentered::forward2Many(Complex *f, Complex *F, unsigned int r, Comple
         Fs[c]=fmHs[c];
     }
   } else {
-    Complex Zetaqr=conj(Zetaq[r]);
+    Vec Zetaqr=CONJ(LOAD(Zetaq+r));
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=0; s < mH; ++s) {
       unsigned int Cs=C*s;
       Complex *Fs=W+Cs;
       Complex *fHs=fH+Cs;
-      Complex Zetars=Zetar[s];
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
       for(unsigned int c=0; c < C; ++c)
-        Fs[c]=Zetars*fHs[c];
+        STORE(Fs+c,ZMULT(X,Y,LOAD(fHs+c)));
     }
     for(unsigned int s=mH; s < LH; ++s) {
       unsigned int Cs=C*s;
       Complex *Fs=W+Cs;
       Complex *fHs=fH+Cs;
       Complex *fmHs=fmH+Cs;
-      Complex Zetars=Zetar[s];
-      Complex Zetarsq=Zetars*Zetaqr;
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
+      Vec Zetarsq=ZMULT(Zetars,Zetaqr);
+      Vec Xq=UNPACKL(Zetarsq,Zetarsq);
+      Vec Yq=UNPACKH(CONJ(Zetarsq),Zetarsq);
       for(unsigned int c=0; c < C; ++c)
-        Fs[c]=Zetarsq*fmHs[c]+Zetars*fHs[c];
+        STORE(Fs+c,ZMULT(Xq,Yq,LOAD(fmHs+c))+ZMULT(X,Y,LOAD(fHs+c)));
     }
     for(unsigned int s=LH; s < m; ++s) {
       unsigned int Cs=C*s;
       Complex *Fs=W+Cs;
       Complex *fmHs=fmH+Cs;
-      Complex Zetars=Zetar[s]*Zetaqr;
+      Vec Zetarsq=ZMULT(LOAD(Zetar+s),Zetaqr);
+      Vec X=UNPACKL(Zetarsq,Zetarsq);
+      Vec Y=UNPACKH(CONJ(Zetarsq),Zetarsq);
       for(unsigned int c=0; c < C; ++c)
-        Fs[c]=Zetars*fmHs[c];
+        STORE(Fs+c,ZMULT(X,Y,LOAD(fmHs+c)));
     }
   }
   fftm->fft(W,F);
@@ -1271,12 +1399,14 @@ void fftPadCentered::backward2(Complex *F0, Complex *f, unsigned int r0, Complex
   for(unsigned int d=first; d < D0; ++d) {
     Complex *F=W+m*d;
     unsigned int r=r0+d;
-    Complex Zetaqr=Zetaq[r];
+    Vec Zetaqr=LOAD(Zetaq+r);
+    Vec X=UNPACKL(Zetaqr,Zetaqr);
+    Vec Y=UNPACKH(CONJ(Zetaqr),Zetaqr);
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=mH; s < m; ++s)
-      fmH[s] += conj(Zetar[s])*Zetaqr*F[s];
+      STORE(fmH+s,LOAD(fmH+s)+ZMULTC(LOAD(Zetar+s),ZMULT(X,Y,LOAD(F+s))));
     for(unsigned int s=0; s < LH; ++s)
-      fH[s] += conj(Zetar[s])*F[s];
+      STORE(fH+s,LOAD(fH+s)+ZMULTC(LOAD(Zetar+s),LOAD(F+s)));
   }
 }
 
@@ -1307,34 +1437,51 @@ void fftPadCentered::backward2Many(Complex *F, Complex *f, unsigned int r, Compl
         fHs[c]=Fs[c];
     }
   } else {
-    Complex Zetaqr=Zetaq[r];
+    Vec Zetaqr=LOAD(Zetaq+r);
     Complex *Zetar=Zetaqm+m*r;
     for(unsigned int s=mH; s < m; ++s) {
       unsigned int Cs=C*s;
       Complex *fmHs=fmH+Cs;
       Complex *Fs=W+Cs;
-      Complex Zetars=conj(Zetar[s])*Zetaqr;
+      Vec Zetars=ZMULTC(LOAD(Zetar+s),Zetaqr);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
       for(unsigned int c=0; c < C; ++c)
-        fmHs[c] += Zetars*Fs[c];
+        STORE(fmHs+c,LOAD(fmHs+c)+ZMULT(X,Y,LOAD(Fs+c)));
     }
     for(unsigned int s=0; s < LH; ++s) {
       unsigned int Cs=C*s;
       Complex *fHs=fH+Cs;
       Complex *Fs=W+Cs;
-      Complex Zetars=conj(Zetar[s]);
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(Zetars,CONJ(Zetars));
       for(unsigned int c=0; c < C; ++c)
-        fHs[c] += Zetars*Fs[c];
+        STORE(fHs+c,LOAD(fHs+c)+ZMULT(X,Y,LOAD(Fs+c)));
     }
   }
 }
 
-void fftPadHermitian::init()
+void fftPadHermitian::parameters()
 {
   common();
   e=m/2;
 
   if(q == 1) {
     b=C*e;
+    Q=1;
+  } else {
+    b=C*(m-e);
+    D=1; // Temporary
+    Q=ceilquotient(q,2);
+  }
+}
+
+void fftPadHermitian::init()
+{
+  parameters();
+
+  if(q == 1) {
     if(C == 1) {
       Forward=&fftBase::forwardExplicit;
       Backward=&fftBase::backwardExplicit;
@@ -1349,10 +1496,7 @@ void fftPadHermitian::init()
     crfftm=new mcrfft1d(m,C, C,C,1,1, G,H);
     rcfftm=new mrcfft1d(m,C, C,C,1,1, H,G);
     deleteAlign(G);
-    Q=1;
   } else {
-    b=C*(m-e);
-    D=1; // Temporary
     bool twop=p == 2;
     if(!twop) {
       cout << "p=" << p << endl;
@@ -1360,8 +1504,6 @@ void fftPadHermitian::init()
       exit(-1);
     }
 
-    Q=ceilquotient(q,2);
-
     Complex *G=ComplexAlign(C*(e+1)*D);
     double *H=inplace ? (double *) G : doubleAlign(Cm*D);
 
@@ -1393,10 +1535,12 @@ void fftPadHermitian::init()
 
   fftBase::Forward=Forward;
   fftBase::Backward=Backward;
+  planned=true;
 }
 
 fftPadHermitian::~fftPadHermitian()
 {
+  if(!planned) return;
   delete crfftm;
   delete rcfftm;
 }
@@ -1596,19 +1740,25 @@ void fftPadHermitian::forward2Many(Complex *f, Complex *F, unsigned int r, Compl
       unsigned int Cs=C*s;
       Complex *Ws=W+Cs;
       Complex *fs=f+Cs;
-      Complex Zetars=Zetar[s];
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
       for(unsigned int c=0; c < C; ++c)
-        Ws[c]=Zetars*fs[c];
+        STORE(Ws+c,ZMULT(X,Y,LOAD(fs+c)));
     }
-    Complex Zetaqr=Zetaq[r];
+    Vec Zetaqr=LOAD(Zetaq+r);
+    Vec Xq=UNPACKL(Zetaqr,Zetaqr);
+    Vec Yq=UNPACKH(CONJ(Zetaqr),Zetaqr);
     for(unsigned int s=mH1; s <= e; ++s) {
       unsigned int Cs=C*s;
       Complex *Ws=W+Cs;
       Complex *fs=f+Cs;
       Complex *fms=fm-Cs;
-      Complex Zetars=Zetar[s];
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(CONJ(Zetars),Zetars);
       for(unsigned int c=0; c < C; ++c)
-        Ws[c]=Zetars*(fs[c]+conj(fms[c]*Zetaqr));
+        STORE(Ws+c,ZMULT(X,Y,LOAD(fs+c)+CONJ(ZMULT(Xq,Yq,LOAD(fms+c)))));
     }
   }
   crfftm->fft(W,F);
@@ -1785,30 +1935,38 @@ void fftPadHermitian::backward2Many(Complex *F, Complex *f, unsigned int r, Comp
       unsigned int Cs=C*s;
       Complex *fs=f+Cs;
       Complex *Ws=W+Cs;
-      Complex Zetars=conj(Zetar[s]);
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(Zetars,CONJ(Zetars));
       for(unsigned int c=0; c < C; ++c)
-        fs[c] += Zetars*Ws[c];
+        STORE(fs+c,LOAD(fs+c)+ZMULT(X,Y,LOAD(Ws+c)));
     }
-    Complex Zetaqr=Zetaq[r];
+    Vec Zetaqr=LOAD(Zetaq+r);
+    Vec Xq=UNPACKL(Zetaqr,Zetaqr);
+    Vec Yq=UNPACKH(CONJ(Zetaqr),Zetaqr);
     for(unsigned int s=mH1; s < me; ++s) {
       unsigned int Cs=C*s;
       Complex *fs=f+Cs;
       Complex *fms=fm-Cs;
       Complex *Ws=W+Cs;
-      Complex Zetars=conj(Zetar[s]);
+      Vec Zetars=LOAD(Zetar+s);
+      Vec X=UNPACKL(Zetars,Zetars);
+      Vec Y=UNPACKH(Zetars,CONJ(Zetars));
       for(unsigned int c=0; c < C; ++c) {
-        Complex A=Zetars*Ws[c];
-        fs[c] += A;
-        fms[c] += conj(A*Zetaqr);
+        Vec A=ZMULT(X,Y,LOAD(Ws+c));
+        STORE(fs+c,LOAD(fs+c)+A);
+        STORE(fms+c,LOAD(fms+c)+CONJ(ZMULT(Xq,Yq,A)));
       }
     }
     if(m == 2*e) {
-      Complex Zetare=conj(Zetar[e]);
+      Vec Zetare=LOAD(Zetar+e);
+      Vec X=UNPACKL(Zetare,Zetare);
+      Vec Y=UNPACKH(Zetare,CONJ(Zetare));
       unsigned int Ce=C*e;
       Complex *fe=f+Ce;
       Complex *We=W+Ce;
       for(unsigned int c=0; c < C; ++c)
-        fe[c] += Zetare*We[c];
+        STORE(fe+c,LOAD(fe+c)+ZMULT(X,Y,LOAD(We+c)));
     }
   }
 
@@ -1819,6 +1977,381 @@ void fftPadHermitian::backward2Many(Complex *F, Complex *f, unsigned int r, Comp
   }
 }
 
+void fftPadReal::parameters()
+{
+  common();
+  e=m/2;
+  D=1; // Temporary
+
+  if(q == 1) {
+    b=C*(e+1);
+    Q=1;
+  } else {
+    b=C;
+    if(p > 1) n=q;
+    Q=q/2+1;
+  }
+}
+
+void fftPadReal::init()
+{
+  parameters();
+
+  if(q == 1) {
+    if(C == 1) {
+      Forward=&fftBase::forwardExplicit;
+      Backward=&fftBase::backwardExplicit;
+    } else {
+      Forward=&fftBase::forwardExplicitMany;
+      Backward=&fftBase::backwardExplicitMany;
+    }
+
+    Complex *G=ComplexAlign(b);
+    double *H=(double *) G;
+
+    rcfftm=new mrcfft1d(m,C, C,C,1,1, H,G);
+    crfftm=new mcrfft1d(m,C, C,C,1,1, G,H);
+    deleteAlign(G);
+  } else {
+    if(p > 1) {
+      initZetaq();
+      Zetaq[0]=1.0;
+    }
+
+    Complex *G=ComplexAlign(Cm);
+    Complex *H=inplace ? G : ComplexAlign(Cm);
+
+    fftm=new mfft1d(m,1,C, C,1, H,G);
+    ifftm=new mfft1d(m,-1,C, C,1, G,H);
+    rcfftm=new mrcfft1d(m,C, C,C,1,1, (double *) H,G);
+    crfftm=new mcrfft1d(m,C, C,C,1,1, G,(double *) H);
+
+    if(C == 1) {
+      Forward=&fftBase::forward;
+      Backward=&fftBase::backward;
+    } else {
+      Forward=&fftBase::forwardMany;
+      Backward=&fftBase::backwardMany;
+    }
+
+    if(!inplace)
+      deleteAlign(H);
+    deleteAlign(G);
+
+    initZetaqm(Q);
+  }
+
+  fftBase::Forward=Forward;
+  fftBase::Backward=Backward;
+  planned=true;
+}
+
+fftPadReal::~fftPadReal()
+{
+  if(!planned) return;
+  delete rcfftm;
+  delete crfftm;
+  if(q > 1) {
+    delete fftm;
+    delete ifftm;
+  }
+}
+
+void fftPadReal::forward(Complex *f, Complex *F)
+{
+  for(unsigned int r=0; r < Q; ++r)
+    (this->*Forward)(f,F+blockOffset(r),r,W0);
+}
+
+void fftPadReal::backward(Complex *F, Complex *f)
+{
+  for(unsigned int r=0; r < Q; ++r)
+    (this->*Backward)(F+blockOffset(r),f,r,W0);
+}
+
+void fftPadReal::forwardExplicit(Complex *f, Complex *F, unsigned int, Complex *W)
+{
+  double *fr=(double *) f;
+  double *Fr=(double *) F;
+  for(unsigned int s=0; s < L; ++s)
+    Fr[s]=fr[s];
+  for(unsigned int s=L; s < m; ++s)
+    Fr[s]=0.0;
+
+  rcfftm->fft(F);
+  for(unsigned int s=0; s <= e; ++s)
+    F[s]=conj(F[s]);
+}
+
+void fftPadReal::forwardExplicitMany(Complex *f, Complex *F, unsigned int, Complex *W)
+{
+  double *fr=(double *) f;
+  double *Fr=(double *) F;
+  unsigned int CL=C*L;
+  for(unsigned int i=0; i < CL; ++i)
+    Fr[i]=fr[i];
+  for(unsigned int i=CL; i < Cm; ++i)
+    Fr[i]=0.0;
+
+  rcfftm->fft(F);
+  for(unsigned int i=0; i < b; ++i)
+    F[i]=conj(F[i]);
+}
+
+void fftPadReal::backwardExplicit(Complex *F, Complex *f, unsigned int, Complex *W)
+{
+  for(unsigned int s=0; s <= e; ++s)
+    F[s]=conj(F[s]);
+  crfftm->fft(F);
+
+  double *fr=(double *) f;
+  double *Fr=(double *) F;
+  for(unsigned int s=0; s < L; ++s)
+    fr[s]=Fr[s];
+}
+
+void fftPadReal::backwardExplicitMany(Complex *F, Complex *f, unsigned int,
+                                      Complex *W)
+{
+  for(unsigned int i=0; i < b; ++i)
+    F[i]=conj(F[i]);
+  crfftm->fft(F);
+
+  double *fr=(double *) f;
+  double *Fr=(double *) F;
+  unsigned int CL=C*L;
+  for(unsigned int i=0; i < CL; ++i)
+    fr[i]=Fr[i];
+}
+
+void fftPadReal::forward(Complex *f, Complex *F, unsigned int r, Complex *W)
+{
+  if(W == NULL) W=F;
+
+  double *fr=(double *) f;
+  unsigned int pm1=p-1;
+  unsigned int stop=L-m*pm1;
+
+  if(r == 0) {
+    double *Wr=(double *) W;
+    if(p == 1) {
+      for(unsigned int s=0; s < L; ++s)
+        Wr[s]=fr[s];
+      for(unsigned int s=L; s < m; ++s)
+        Wr[s]=0.0;
+    } else {
+      for(unsigned int s=0; s < m; ++s)
+        Wr[s]=fr[s];
+      for(unsigned int t=1; t < p; ++t) {
+        double *ft=fr+m*t;
+        unsigned int stopt=t < pm1 ? m : stop;
+        for(unsigned int s=0; s < stopt; ++s)
+          Wr[s] += ft[s];
+      }
+    }
+    rcfftm->fft(Wr,F);
+    for(unsigned int s=0; s <= e; ++s)
+      F[s]=conj(F[s]);
+  } else {
+    Complex *Zetar=Zetaqm+m*r;
+    if(p == 1) {
+      W[0]=fr[0];
+      for(unsigned int s=1; s < L; ++s)
+        W[s]=Zetar[s]*fr[s];
+      for(unsigned int s=L; s < m; ++s)
+        W[s]=0.0;
+    } else {
+      for(unsigned int s=0; s < m; ++s)
+        W[s]=fr[s];
+      for(unsigned int t=1; t < p; ++t) {
+        Complex Zetaqrt=Zetaq[r*t % q];
+        double *ft=fr+m*t;
+        unsigned int stopt=t < pm1 ? m : stop;
+        for(unsigned int s=0; s < stopt; ++s)
+          W[s] += Zetaqrt*ft[s];
+      }
+      for(unsigned int s=1; s < m; ++s)
+        W[s] *= Zetar[s];
+    }
+    fftm->fft(W,F);
+  }
+}
+
+void fftPadReal::forwardMany(Complex *f, Complex *F, unsigned int r, Complex *W)
+{
+  if(W == NULL) W=F;
+
+  double *fr=(double *) f;
+  unsigned int pm1=p-1;
+  unsigned int stop=C*(L-m*pm1);
+
+  if(r == 0) {
+    double *Wr=(double *) W;
+    if(p == 1) {
+      unsigned int CL=C*L;
+      for(unsigned int i=0; i < CL; ++i)
+        Wr[i]=fr[i];
+      for(unsigned int i=CL; i < Cm; ++i)
+        Wr[i]=0.0;
+    } else {
+      for(unsigned int i=0; i < Cm; ++i)
+        Wr[i]=fr[i];
+      for(unsigned int t=1; t < p; ++t) {
+        double *ft=fr+Cm*t;
+        unsigned int stopt=t < pm1 ? Cm : stop;
+        for(unsigned int i=0; i < stopt; ++i)
+          Wr[i] += ft[i];
+      }
+    }
+    rcfftm->fft(Wr,F);
+    unsigned int Ce1=C*(e+1);
+    for(unsigned int i=0; i < Ce1; ++i)
+      F[i]=conj(F[i]);
+  } else {
+    Complex *Zetar=Zetaqm+m*r;
+    if(p == 1) {
+      for(unsigned int c=0; c < C; ++c)
+        W[c]=fr[c];
+      for(unsigned int s=1; s < L; ++s) {
+        unsigned int Cs=C*s;
+        Complex *Ws=W+Cs;
+        double *fs=fr+Cs;
+        Complex Zetars=Zetar[s];
+        for(unsigned int c=0; c < C; ++c)
+          Ws[c]=Zetars*fs[c];
+      }
+      for(unsigned int s=L; s < m; ++s) {
+        Complex *Ws=W+C*s;
+        for(unsigned int c=0; c < C; ++c)
+          Ws[c]=0.0;
+      }
+    } else {
+      for(unsigned int i=0; i < Cm; ++i)
+        W[i]=fr[i];
+      for(unsigned int t=1; t < p; ++t) {
+        Complex Zetaqrt=Zetaq[r*t % q];
+        double *ft=fr+Cm*t;
+        unsigned int stopt=t < pm1 ? Cm : stop;
+        for(unsigned int i=0; i < stopt; ++i)
+          W[i] += Zetaqrt*ft[i];
+      }
+      for(unsigned int s=1; s < m; ++s) {
+        Complex *Ws=W+C*s;
+        Complex Zetars=Zetar[s];
+        for(unsigned int c=0; c < C; ++c)
+          Ws[c] *= Zetars;
+      }
+    }
+    fftm->fft(W,F);
+  }
+}
+
+void fftPadReal::backward(Complex *F, Complex *f, unsigned int r, Complex *W)
+{
+  if(W == NULL) W=F;
+
+  double *fr=(double *) f;
+  unsigned int pm1=p-1;
+  unsigned int stop=L-m*pm1;
+
+  if(r == 0) {
+    for(unsigned int s=0; s <= e; ++s)
+      F[s]=conj(F[s]);
+    double *Wr=(double *) W;
+    crfftm->fft(F,Wr);
+    for(unsigned int t=0; t < p; ++t) {
+      double *ft=fr+m*t;
+      unsigned int stopt=t < pm1 ? m : stop;
+      for(unsigned int s=0; s < stopt; ++s)
+        ft[s]=Wr[s];
+    }
+  } else {
+    ifftm->fft(F,W);
+    Complex *Zetar=Zetaqm+m*r;
+    // Residue q-r contributes the complex conjugate of residue r.
+    double factor=2*r == q ? 1.0 : 2.0;
+    if(p == 1) {
+      fr[0] += factor*W[0].real();
+      for(unsigned int s=1; s < L; ++s) {
+        Complex Zetars=Zetar[s];
+        Complex Ws=W[s];
+        fr[s] += factor*(Zetars.real()*Ws.real()+Zetars.imag()*Ws.imag());
+      }
+    } else {
+      W[0] *= factor;
+      for(unsigned int s=1; s < m; ++s)
+        W[s]=factor*conj(Zetar[s])*W[s];
+      for(unsigned int t=0; t < p; ++t) {
+        Complex Zetaqrt=Zetaq[r*t % q];
+        double *ft=fr+m*t;
+        unsigned int stopt=t < pm1 ? m : stop;
+        for(unsigned int s=0; s < stopt; ++s) {
+          Complex Ws=W[s];
+          ft[s] += Zetaqrt.real()*Ws.real()+Zetaqrt.imag()*Ws.imag();
+        }
+      }
+    }
+  }
+}
+
+void fftPadReal::backwardMany(Complex *F, Complex *f, unsigned int r, Complex *W)
+{
+  if(W == NULL) W=F;
+
+  double *fr=(double *) f;
+  unsigned int pm1=p-1;
+  unsigned int stop=C*(L-m*pm1);
+
+  if(r == 0) {
+    unsigned int Ce1=C*(e+1);
+    for(unsigned int i=0; i < Ce1; ++i)
+      F[i]=conj(F[i]);
+    double *Wr=(double *) W;
+    crfftm->fft(F,Wr);
+    for(unsigned int t=0; t < p; ++t) {
+      double *ft=fr+Cm*t;
+      unsigned int stopt=t < pm1 ? Cm : stop;
+      for(unsigned int i=0; i < stopt; ++i)
+        ft[i]=Wr[i];
+    }
+  } else {
+    ifftm->fft(F,W);
+    Complex *Zetar=Zetaqm+m*r;
+    // Residue q-r contributes the complex conjugate of residue r.
+    double factor=2*r == q ? 1.0 : 2.0;
+    if(p == 1) {
+      for(unsigned int c=0; c < C; ++c)
+        fr[c] += factor*W[c].real();
+      for(unsigned int s=1; s < L; ++s) {
+        unsigned int Cs=C*s;
+        double *fs=fr+Cs;
+        Complex *Ws=W+Cs;
+        Complex Zetars=factor*Zetar[s];
+        for(unsigned int c=0; c < C; ++c)
+          fs[c] += Zetars.real()*Ws[c].real()+Zetars.imag()*Ws[c].imag();
+      }
+    } else {
+      for(unsigned int c=0; c < C; ++c)
+        W[c] *= factor;
+      for(unsigned int s=1; s < m; ++s) {
+        Complex *Ws=W+C*s;
+        Complex Zetars=factor*conj(Zetar[s]);
+        for(unsigned int c=0; c < C; ++c)
+          Ws[c] *= Zetars;
+      }
+      for(unsigned int t=0; t < p; ++t) {
+        Complex Zetaqrt=Zetaq[r*t % q];
+        double *ft=fr+Cm*t;
+        unsigned int stopt=t < pm1 ? Cm : stop;
+        for(unsigned int i=0; i < stopt; ++i) {
+          Complex Wi=W[i];
+          ft[i] += Zetaqrt.real()*Wi.real()+Zetaqrt.imag()*Wi.imag();
+        }
+      }
+    }
+  }
+}
+
 void Convolution::init(Complex *F, Complex *V)
 {
   Forward=fft->Forward;
@@ -1911,20 +2444,20 @@ Convolution::~Convolution()
 // h is an output array of B pointers to distinct data blocks each of size
 // fft->length(), which may coincide with f.
 // offset is applied to each input and output component
-void Convolution::convolve0(Complex **f, Complex **h, multiplier *mult,
-                            unsigned int offset)
+void Convolution::convolveResidues(Complex **f, Complex **h,
+                                   unsigned int offset)
 {
   if(q == 1) {
     for(unsigned int a=0; a < A; ++a)
       (fft->*Forward)(f[a]+offset,F[a],0,NULL);
-    (*mult)(F,b,threads);
+    multiply(F,b);
     for(unsigned int b=0; b < B; ++b)
       (fft->*Backward)(F[b],h[b]+offset,0,NULL);
   } else {
     if(loop2) {
       for(unsigned int a=0; a < A; ++a)
         (fft->*Forward)(f[a]+offset,F[a],0,W);
-      (*mult)(F,fft->conjugates(0)*b*D,threads);
+      multiply(F,fft->conjugates(0)*b*D);
 
       for(unsigned int b=0; b < B; ++b) {
         (fft->*Forward)(f[b]+offset,Fp[b],D,W);
@@ -1933,7 +2466,7 @@ void Convolution::convolve0(Complex **f, Complex **h, multiplier *mult,
       }
       for(unsigned int a=B; a < A; ++a)
         (fft->*Forward)(f[a]+offset,Fp[a],D,W);
-      (*mult)(Fp,fft->conjugates(1)*b*D,threads);
+      multiply(Fp,fft->conjugates(1)*b*D);
       for(unsigned int b=0; b < B; ++b)
         (fft->*Backward)(Fp[b],h[b]+offset,D,FpB);
     } else {
@@ -1953,7 +2486,7 @@ void Convolution::convolve0(Complex **f, Complex **h, multiplier *mult,
         if(D0 > D) D0=D;
         for(unsigned int a=0; a < A; ++a)
           (fft->*Forward)(f[a]+offset,F[a],r,W);
-        (*mult)(F,fft->conjugates(r)*b*D0,threads);
+        multiply(F,fft->conjugates(r)*b*D0);
         for(unsigned int b=0; b < B; ++b)
           (fft->*Backward)(F[b],h0[b]+Offset,r,W0);
         (fft->*Pad)(W);
@@ -1961,8 +2494,8 @@ void Convolution::convolve0(Complex **f, Complex **h, multiplier *mult,
 
       if(useV) {
         for(unsigned int b=0; b < B; ++b) {
-          Complex *fb=f[b]+offset;
-          Complex *hb=h0[b];
+          double *fb=(double *) (f[b]+offset);
+          double *hb=(double *) h0[b];
           for(unsigned int i=0; i < noutputs; ++i)
             fb[i]=hb[i];
         }
@@ -1986,7 +2519,7 @@ void ForwardBackward::init(fftBase &fft)
   F=new Complex*[N];
   h=new Complex*[B];
 
-  unsigned CL=C*L;
+  unsigned CL=C*fft.L;
 
   for(unsigned int a=0; a < A; ++a)
     f[a]=ComplexAlign(CL);
@@ -2060,7 +2593,7 @@ void optionsHybrid(int argc, char* argv[])
   optind=0;
 #endif
   for (;;) {
-    int c = getopt(argc,argv,"hC:D:I:L:M:O:S:T:m:");
+    int c = getopt(argc,argv,"hC:D:I:L:M:O:R:S:T:m:");
     if (c == -1) break;
 
     switch (c) {
@@ -2081,6 +2614,9 @@ void optionsHybrid(int argc, char* argv[])
       case 'M':
         M=atoi(optarg);
         break;
+      case 'R':
+        ROption=atof(optarg);
+        break;
       case 'S':
         surplusFFTsizes=atoi(optarg);
         break;
@@ -54,6 +54,7 @@ extern unsigned int mOption;
 extern unsigned int DOption;
 
 extern int IOption;
+extern size_t ROption;
 
 // Temporary
 extern unsigned int A; // number of inputs
@@ -122,6 +123,7 @@ public:
   unsigned int b; // Block size
   Complex *W0; // Temporary work memory for testing accuracy
   bool inplace;
+  bool planned; // FFTs and twiddle factors allocated
 
   FFTcall Forward,Backward;
   FFTPad Pad;
@@ -136,7 +138,6 @@ public:
   void common();
 
   void initZetaq() {
-    Q=n=q;
     Zetaq=utils::ComplexAlign(q);
     double twopibyq=twopi/q;
     for(unsigned int r=1; r < q; ++r)
@@ -162,6 +163,13 @@ public:
                         unsigned int m, unsigned int q,unsigned int D,
                         Application &app)=0;
 
+    // Report the memory used by the unplanned engine sizes and return
+    // true if it fits within ROption.
+    bool fits(fftBase& sizes);
+
+    // Return the mean time of fft, reporting it if ROption is set.
+    double meantime(fftBase& fft, Application& app);
+
     void check(unsigned int L, unsigned int M,
                Application& app, unsigned int C, unsigned int m,
                bool fixed=false, bool mForced=false);
@@ -246,6 +254,18 @@ public:
     return q == 1 || inplace ? 0 : outputSize();
   }
 
+  // Number of Complex twiddle factors.
+  virtual unsigned int twiddleSize() {
+    return 0;
+  }
+
+  // Number of bytes of work memory and twiddle factors used by a
+  // Convolution with A inputs and B outputs.
+  size_t workMemory() {
+    return sizeof(Complex)*(std::max(A,B)*outputSize()+B*workSizeV()+
+                            workSizeW()+twiddleSize());
+  }
+
   unsigned int repad() {
     return !inplace && L < m;
   }
@@ -283,16 +303,20 @@ public:
     double time(unsigned int L, unsigned int M, unsigned int C,
                 unsigned int m, unsigned int q,unsigned int D,
                 Application &app) {
+      fftPad sizes(L,M,C,m,q,D,false);
+      if(!fits(sizes)) return DBL_MAX;
       fftPad fft(L,M,C,m,q,D);
-      return fft.meantime(app);
+      return meantime(fft,app);
     }
   };
 
   // Compute an fft padded to N=m*q >= M >= L
+  // If plan=false, only the sizes are computed.
   fftPad(unsigned int L, unsigned int M, unsigned int C,
-         unsigned int m, unsigned int q,unsigned int D) :
+         unsigned int m, unsigned int q,unsigned int D, bool plan=true) :
     fftBase(L,M,C,m,q,D) {
-    init();
+    if(plan) init();
+    else parameters();
   }
 
   // Normal entry point.
@@ -312,8 +336,16 @@ public:
 
   ~fftPad();
 
+  // p=2 && q odd
+  bool twop() {
+    return p == 2 && 2*n != q;
+  }
+
+  void parameters();
   void init();
 
+  unsigned int twiddleSize();
+
   // Explicitly pad to m.
   void padSingle(Complex *W);
 
@@ -375,16 +407,20 @@ public:
     double time(unsigned int L, unsigned int M, unsigned int C,
                 unsigned int m, unsigned int q,unsigned int D,
                 Application &app) {
+      fftPadCentered sizes(L,M,C,m,q,D,false);
+      if(!fits(sizes)) return DBL_MAX;
       fftPad fft(L,M,C,m,q,D);
-      return fft.meantime(app);
+      return meantime(fft,app);
     }
   };
 
   // Compute an fft padded to N=m*q >= M >= L
+  // If plan=false, only the sizes are computed.
   fftPadCentered(unsigned int L, unsigned int M, unsigned int C,
-                 unsigned int m, unsigned int q,unsigned int D) :
-    fftPad(L,M,C,m,q,D) {
-    init();
+                 unsigned int m, unsigned int q,unsigned int D,
+                 bool plan=true) :
+    fftPad(L,M,C,m,q,D,plan), ZetaShift(NULL) {
+    if(plan) init();
   }
 
   // Normal entry point.
@@ -404,6 +440,11 @@ public:
   void init();
   void initShift();
 
+  // ZetaShift is used unless the p=2 && q odd routines apply.
+  unsigned int twiddleSize() {
+    return fftPad::twiddleSize()+(q > 1 && twop() ? 0 : M);
+  }
+
   void forwardShifted(Complex *f, Complex *F, unsigned int r, Complex *W);
   void backwardShifted(Complex *F, Complex *f, unsigned int r, Complex *W);
 
@@ -436,15 +477,20 @@ public:
                 unsigned int m, unsigned int q,unsigned int D,
                 Application &app) {
       D=1; // D > 1 is not yet implemented
+      fftPadHermitian sizes(L,M,C,m,q,D,false);
+      if(!fits(sizes)) return DBL_MAX;
       fftPadHermitian fft(L,M,C,m,q,D);
-      return fft.meantime(app);
+      return meantime(fft,app);
     }
   };
 
+  // If plan=false, only the sizes are computed.
   fftPadHermitian(unsigned int L, unsigned int M, unsigned int C,
-                  unsigned int m, unsigned int q, unsigned int D) :
+                  unsigned int m, unsigned int q, unsigned int D,
+                  bool plan=true) :
     fftBase(L,M,C,m,q,D) {
-    init();
+    if(plan) init();
+    else parameters();
   }
 
   fftPadHermitian(unsigned int L, unsigned int M, Application& app,
@@ -461,8 +507,13 @@ public:
 
   ~fftPadHermitian();
 
+  void parameters();
   void init();
 
+  unsigned int twiddleSize() {
+    return q > 1 ? q/2*m : 0;
+  }
+
   void forward(Complex *f, Complex *F);
   void backward(Complex *F, Complex *f);
 
@@ -497,6 +548,105 @@ public:
 
 };
 
+// Compute an fft of real data padded to N=m*q >= M >= L.
+// Only the residues r=0,...,q/2 are computed; the others follow from
+// Hermitian symmetry. Residue 0 is returned as the e+1 nonnegative
+// frequencies of a real transform.
+class fftPadReal : public fftBase {
+  unsigned int e;
+  mfft1d *fftm,*ifftm;
+  mrcfft1d *rcfftm;
+  mcrfft1d *crfftm;
+public:
+  FFTcall Forward,Backward;
+
+  class Opt : public OptBase {
+  public:
+    Opt(unsigned int L, unsigned int M, Application& app,
+        unsigned int C, bool Explicit=false, bool fixed=false) {
+      scan(L,M,app,C,Explicit,fixed);
+    }
+
+    double time(unsigned int L, unsigned int M, unsigned int C,
+                unsigned int m, unsigned int q,unsigned int D,
+                Application &app) {
+      D=1; // D > 1 is not yet implemented
+      fftPadReal sizes(L,M,C,m,q,D,false);
+      if(!fits(sizes)) return DBL_MAX;
+      fftPadReal fft(L,M,C,m,q,D);
+      return meantime(fft,app);
+    }
+  };
+
+  // If plan=false, only the sizes are computed.
+  fftPadReal(unsigned int L, unsigned int M, unsigned int C,
+             unsigned int m, unsigned int q, unsigned int D,
+             bool plan=true) :
+    fftBase(L,M,C,m,q,D) {
+    if(plan) init();
+    else parameters();
+  }
+
+  // Normal entry point.
+  // Compute C ffts of L real values and distance 1 padded to at least M
+  // (or exactly M if fixed=true)
+  fftPadReal(unsigned int L, unsigned int M, Application& app,
+             unsigned int C=1, bool Explicit=false, bool fixed=false) :
+    fftBase(L,M,app,C,Explicit,fixed) {
+    Opt opt=Opt(L,M,app,C,Explicit,fixed);
+    m=opt.m;
+    if(Explicit)
+      M=m;
+    q=opt.q;
+    D=opt.D;
+    init();
+  }
+
+  ~fftPadReal();
+
+  void parameters();
+  void init();
+
+  unsigned int twiddleSize() {
+    return q > 1 ? (p > 1 ? q : 0)+q/2*m : 0;
+  }
+
+  void forward(Complex *f, Complex *F);
+  void backward(Complex *F, Complex *f);
+
+  void forwardExplicit(Complex *f, Complex *F, unsigned int, Complex *W);
+  void forwardExplicitMany(Complex *f, Complex *F, unsigned int, Complex *W);
+
+  void backwardExplicit(Complex *F, Complex *f, unsigned int, Complex *W);
+  void backwardExplicitMany(Complex *F, Complex *f, unsigned int, Complex *W);
+
+  // The input f is an array of C*L doubles.
+  void forward(Complex *f, Complex *F, unsigned int r, Complex *W);
+  void forwardMany(Complex *f, Complex *F, unsigned int r, Complex *W);
+
+  // Accumulate the real contribution of residue r (and q-r) to f.
+  // Input F destroyed
+  void backward(Complex *F, Complex *f, unsigned int r, Complex *W);
+  void backwardMany(Complex *F, Complex *f, unsigned int r, Complex *W);
+
+  unsigned int outputSize() {
+    return q == 1 ? b : Cm;
+  }
+
+  unsigned int fullOutputSize() {
+    return q == 1 ? b : C*(e+1+m*(Q-1));
+  }
+
+  // For q > 1, b=C and residue 0 consists of e+1 blocks.
+  unsigned int conjugates(unsigned int r) {
+    return r == 0 ? e+1 : m;
+  }
+
+  unsigned int blockOffset(unsigned int r) {
+    return r == 0 ? 0 : C*(e+1+m*(r-1));
+  }
+};
+
 class ForwardBackward : public Application {
 protected:
   unsigned int A;
@@ -529,10 +679,20 @@ public:
 
 typedef void multiplier(Complex **, unsigned int e, unsigned int threads);
 
+// A pre-scaled multiplier also multiplies its output by the normalization
+// factor scale, so that no separate normalization pass is required.
+typedef void scaledmultiplier(Complex **, unsigned int e, double scale,
+                              unsigned int threads);
+
 // Multiplication routine for binary convolutions and taking two inputs of size e.
 void multbinary(Complex **F, unsigned int e, unsigned int threads);
 void realmultbinary(Complex **F, unsigned int e, unsigned int threads);
 
+void scaledmultbinary(Complex **F, unsigned int e, double scale,
+                      unsigned int threads);
+void scaledrealmultbinary(Complex **F, unsigned int e, double scale,
+                          unsigned int threads);
+
 
 class Convolution {
 public:
@@ -556,11 +716,24 @@ protected:
   bool allocateV;
   bool allocateW;
   bool loop2;
-  unsigned int noutputs;
+  unsigned int noutputs; // Number of doubles in each output
 
   FFTcall Forward,Backward;
   FFTPad Pad;
 
+  multiplier *mult;
+  scaledmultiplier *smult;
+  double multscale;
+
+  void multiply(Complex **F, unsigned int e) {
+    if(smult)
+      (*smult)(F,e,multscale,threads);
+    else
+      (*mult)(F,e,threads);
+  }
+
+  void convolveResidues(Complex **f, Complex **h, unsigned int offset);
+
 public:
   // A is the number of inputs.
   // B is the number of outputs.
@@ -577,7 +750,7 @@ public:
               Complex *F=NULL, Complex *V=NULL, Complex *W=NULL) :
     fft(&fft), A(A), B(B), W(W), allocate(false) {
     init(F,V);
-    noutputs=C*L;
+    noutputs=2*C*L;
   }
 
   void init(Complex *F, Complex *V);
@@ -594,20 +767,38 @@ public:
 
   void normalize(Complex **h, unsigned int offset=0) {
     for(unsigned int b=0; b < B; ++b) {
-      Complex *hb=h[b]+offset;
+      double *hb=(double *) (h[b]+offset);
       for(unsigned int i=0; i < noutputs; ++i)
         hb[i] *= scale;
     }
   }
 
   void convolve0(Complex **f, Complex **h, multiplier *mult,
-                 unsigned int offset=0);
+                 unsigned int offset=0) {
+    this->mult=mult;
+    smult=NULL;
+    convolveResidues(f,h,offset);
+  }
+
+  // The pre-scaled multiplier mult is passed the normalization factor scale.
+  void convolve0(Complex **f, Complex **h, scaledmultiplier *mult,
+                 double scale, unsigned int offset=0) {
+    smult=mult;
+    multscale=scale;
+    convolveResidues(f,h,offset);
+  }
 
   void convolve(Complex **f, Complex **h, multiplier *mult,
                 unsigned int offset=0) {
     convolve0(f,h,mult,offset);
     normalize(h,offset);
   }
+
+  // Normalize within the multiplier; the output is written only once.
+  void convolve(Complex **f, Complex **h, scaledmultiplier *mult,
+                unsigned int offset=0) {
+    convolve0(f,h,mult,scale,offset);
+  }
 };
 
 class ConvolutionHermitian : public Convolution {
@@ -625,7 +816,24 @@ public:
     this->fft=&fft;
     init(F,V);
     b=q == 1 ? fft.Cm : 2*fft.b;
-    noutputs=C*utils::ceilquotient(L,2);
+    noutputs=2*C*utils::ceilquotient(L,2);
+  }
+};
+
+class ConvolutionReal : public Convolution {
+public:
+  // A is the number of inputs.
+  // B is the number of outputs.
+  // Each input and output is an array of C*L doubles.
+  // F is an optional work array of size max(A,B)*fft->outputSize(),
+  // V is an optional work array of size B*fft->workSizeV() (for inplace usage)
+  // W is an optional work array of size fft->workSizeW();
+  ConvolutionReal(fftPadReal &fft, unsigned int A=2,
+                  unsigned int B=1, Complex *F=NULL, Complex *V=NULL,
+                  Complex *W=NULL) : Convolution(A,B,F,V,W) {
+    this->fft=&fft;
+    init(F,V);
+    noutputs=C*L;
   }
 };
 
@@ -658,7 +866,9 @@ public:
     init(Fx);
   }
 
-  void init(Complex *Fx) {
+  // Each of the max(A,B) blocks of Fx has the given size, which defaults
+  // to fftx->outputSize().
+  void init(Complex *Fx, unsigned int size=0) {
     Forward=fftx->Forward;
     Backward=fftx->Backward;
 
@@ -666,6 +876,7 @@ public:
     B=convolvey->B;
 
     unsigned int c=fftx->outputSize();
+    if(size == 0) size=c;
 
     qx=fftx->q;
     Qx=fftx->Q;
@@ -676,11 +887,11 @@ public:
     this->Fx=new Complex*[N];
     if(Fx) {
       for(unsigned int i=0; i < N; ++i)
-        this->Fx[i]=Fx+i*c;
+        this->Fx[i]=Fx+i*size;
     } else {
       allocate=true;
       for(unsigned int i=0; i < N; ++i)
-        this->Fx[i]=utils::ComplexAlign(c);
+        this->Fx[i]=utils::ComplexAlign(size);
     }
 
     Lx=fftx->L;
@@ -720,6 +931,12 @@ public:
       convolvey->convolve0(f,f,mult,offset+i*stride);
   }
 
+  void subconvolution(Complex **f, scaledmultiplier *mult, unsigned int C,
+                      unsigned int stride, unsigned int offset=0) {
+    for(unsigned int i=0; i < C; ++i)
+      convolvey->convolve0(f,f,mult,scale,offset+i*stride);
+  }
+
   void backward(Complex **F, Complex **f, unsigned int rx) {
     // TODO: Support out-of-place
     for(unsigned int b=0; b < B; ++b)
@@ -744,6 +961,16 @@ public:
       }
     }
   }
+
+  // Normalize within the multiplier; the output is written only once.
+  virtual void convolve(Complex **f, Complex **h, scaledmultiplier *mult,
+                        unsigned int offset=0) {
+    for(unsigned int rx=0; rx < Qx; ++rx) {
+      forward(f,Fx,rx);
+      subconvolution(Fx,mult,Sx,Ly,offset);
+      backward(Fx,h,rx);
+    }
+  }
 };
 
 class ConvolutionHermitian2 : public Convolution2 {
@@ -53,7 +53,7 @@ int main(int argc, char* argv[])
   double t0=totalseconds();
 
   for(unsigned int k=0; k < K; ++k)
-    Convolve.convolve(F,F,multbinary);
+    Convolve.convolve(F,F,scaledmultbinary);
 
   double t=totalseconds();
   cout << (t-t0)/K << endl;
@@ -61,7 +61,7 @@ int main(int argc, char* argv[])
   double t0=totalseconds();
 
   for(unsigned int k=0; k < K; ++k)
-    Convolve.convolve(F,F,realmultbinary);
+    Convolve.convolve(F,F,scaledrealmultbinary);
 
   double t=totalseconds();
   cout << (t-t0)/K << endl;
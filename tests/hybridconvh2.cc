@@ -87,7 +87,7 @@ int main(int argc, char* argv[])
   double t0=totalseconds();
 
   for(unsigned int k=0; k < K; ++k)
-    Convolve2.convolve(f,h,realmultbinary);
+    Convolve2.convolve(f,h,scaledrealmultbinary);
 
   double t=totalseconds();
   cout << (t-t0)/K << endl;
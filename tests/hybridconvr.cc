@@ -0,0 +1,68 @@
+#include "convolve.h"
+
+#define OUTPUT 0
+
+using namespace std;
+using namespace utils;
+using namespace Array;
+using namespace fftwpp;
+
+int main(int argc, char* argv[])
+{
+  fftw::maxthreads=1;//get_max_threads();
+
+#ifndef __SSE2__
+  fftw::effort |= FFTW_NO_SIMD;
+#endif
+
+  L=512;
+  M=1024;
+
+  optionsHybrid(argc,argv);
+
+  ForwardBackward FB;
+  Application *app=&FB;
+
+  fftPadReal fft(L,M,*app,C);
+
+  double *f=doubleAlign(C*L);
+  double *g=doubleAlign(C*L);
+
+#if OUTPUT
+  for(unsigned int j=0; j < L; ++j) {
+    for(unsigned int c=0; c < C; ++c) {
+      f[C*j+c]=j+1;
+      g[C*j+c]=2*j+1;
+    }
+  }
+#else
+  for(unsigned int j=0; j < C*L; ++j) {
+    f[j]=0.0;
+    g[j]=0.0;
+  }
+#endif
+
+  ConvolutionReal Convolve(fft);
+
+  Complex *F[]={(Complex *) f,(Complex *) g};
+#if OUTPUT
+  unsigned int K=1;
+#else
+  unsigned int K=1000000;
+#endif
+  double t0=totalseconds();
+
+  for(unsigned int k=0; k < K; ++k)
+    Convolve.convolve(F,F,scaledmultbinary);
+
+  double t=totalseconds();
+  cout << (t-t0)/K << endl;
+  cout << endl;
+#if OUTPUT
+  for(unsigned int j=0; j < L; ++j)
+    for(unsigned int c=0; c < C; ++c)
+      cout << f[C*j+c] << endl;
+#endif
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include "convolve.h"
+
+using namespace std;
+using namespace utils;
+using namespace Array;
+using namespace fftwpp;
+
+int main(int argc, char* argv[])
+{
+  fftw::maxthreads=1;//get_max_threads();
+
+#ifndef __SSE2__
+  fftw::effort |= FFTW_NO_SIMD;
+#endif
+
+  L=512;
+  M=1024;
+
+  optionsHybrid(argc,argv);
+
+  ForwardBackward FB;
+  Application *app=&FB;
+
+  cout << "Explicit:" << endl;
+  // Minimal explicit padding
+  fftPadReal fft0(L,M,*app,C,true,true);
+
+  double mean0=fft0.report(*app);
+
+  // Optimal explicit padding
+  fftPadReal fft1(L,M,*app,C,true,false);
+  double mean1=min(mean0,fft1.report(*app));
+
+  // Hybrid padding
+  fftPadReal fft(L,M,*app,C);
+
+  double mean=fft.report(*app);
+
+  if(mean0 > 0)
+    cout << "minimal ratio=" << mean/mean0 << endl;
+  cout << endl;
+
+  if(mean1 > 0)
+    cout << "optimal ratio=" << mean/mean1 << endl;
+  cout << endl;
+
+  double *f=doubleAlign(C*L);
+  Complex *F=ComplexAlign(fft.fullOutputSize());
+  fft.W0=ComplexAlign(fft.workSizeW());
+
+  for(unsigned int j=0; j < L; ++j)
+    for(unsigned int c=0; c < C; ++c)
+      f[C*j+c]=j+1+c;
+
+  fft.forward((Complex *) f,F);
+
+  double *f0=doubleAlign(C*L);
+  Complex *F0=ComplexAlign(fft.fullOutputSize());
+
+  for(unsigned int j=0; j < fft.fullOutputSize(); ++j)
+    F0[j]=F[j];
+
+  fft.backward(F0,(Complex *) f0);
+
+  double scale=1.0/fft.normalization();
+
+  if(L < 30) {
+    cout << endl;
+    cout << "Inverse:" << endl;
+    for(unsigned int j=0; j < C*L; ++j)
+      cout << f0[j]*scale << endl;
+    cout << endl;
+  }
+
+  // Compare with an explicitly padded complex transform.
+  fftPad fft2(L,fft.M,C,fft.M,1,1);
+  Complex *f2=ComplexAlign(C*L);
+  Complex *F2=ComplexAlign(fft2.fullOutputSize());
+
+  for(unsigned int j=0; j < C*L; ++j)
+    f2[j]=f[j];
+  fft2.forward(f2,F2);
+
+  double error=0.0, norm=0.0;
+  double error2=0.0, norm2=0.0;
+
+  unsigned int m=fft.m;
+  unsigned int q=fft.q;
+  unsigned int e=m/2;
+
+  for(unsigned int r=0; r < fft.Q; ++r) {
+    Complex *Fr=F+fft.blockOffset(r);
+    unsigned int stop=q == 1 || r == 0 ? e+1 : m;
+    for(unsigned int s=0; s < stop; ++s) {
+      for(unsigned int c=0; c < C; ++c) {
+        unsigned int i=C*(q*s+r)+c;
+        error += abs2(Fr[C*s+c]-F2[i]);
+        norm += abs2(F2[i]);
+      }
+    }
+  }
+
+  for(unsigned int j=0; j < C*L; ++j) {
+    error2 += abs2(f0[j]*scale-f[j]);
+    norm2 += abs2(f[j]);
+  }
+
+  if(norm > 0) error=sqrt(error/norm);
+  if(norm2 > 0) error2=sqrt(error2/norm2);
+  double eps=1e-12;
+  if(error > eps || error2 > eps)
+    cerr << endl << "WARNING: " << endl;
+  cout << "forward error=" << error << endl;
+  cout << "backward error=" << error2 << endl;
+
+  return 0;
+}
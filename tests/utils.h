@@ -95,8 +95,8 @@ inline void usageTranspose()
 {
   std::cerr << "-a<int>\t\t block divisor: -1=sqrt(size), [0]=Tune"
             << std::endl;
-  std::cerr << "-s<int>\t\t alltoall: [-1]=Tune, 0=Optimized, 1=MPI, 2=compact"
-            << std::endl;
+  std::cerr << "-s<int>\t\t alltoall: [-1]=Tune, 0=Optimized, 1=MPI, 2=compact,"
+            << " 3=shared, 4=datatype" << std::endl;
   std::cerr << "-q\t\t quiet" << std::endl;
 }
 
@@ -143,6 +143,8 @@ inline void usageHybrid()
   std::cerr << "-I\t\t use in-place FFTs [by default only for C > 1]" << std::endl;
   std::cerr << "-L\t\t number of physical data values" << std::endl;
   std::cerr << "-M\t\t minimal number of padded data values" << std::endl;
+  std::cerr << "-R\t\t work and twiddle memory budget in bytes [0=unlimited]"
+            << std::endl;
   std::cerr << "-S\t\t number of surplus FFT sizes" << std::endl;
   std::cerr << "-T\t\t number of threads" << std::endl;
 }